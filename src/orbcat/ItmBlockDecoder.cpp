@@ -0,0 +1,216 @@
+#include "ItmBlockDecoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace orbcat {
+
+namespace {
+
+/* A synchronisation packet is at least 47 zero bits followed by a one, i.e. five 0x00 bytes and then 0x80 */
+constexpr uint32_t SYNC_ZEROS = 5;
+constexpr uint8_t SYNC_END = 0x80;
+constexpr uint8_t OVERFLOW = 0x70;
+constexpr uint8_t GLOBAL_TIMESTAMP_1 = 0x94;
+constexpr uint8_t GLOBAL_TIMESTAMP_2 = 0xB4;
+constexpr uint8_t HW_EXCEPTION_TRACE = 1;
+constexpr uint8_t HW_PC_SAMPLE = 2;
+constexpr uint8_t MAX_CONTINUATION_BYTES = 6;
+
+constexpr uint8_t PayloadSize(uint8_t header) {
+    constexpr uint8_t sizes[] = {0, 1, 2, 4};
+    return sizes[header & 0x03];
+}
+
+constexpr bool IsSourcePacket(uint8_t header) {
+    return (header & 0x03) != 0;
+}
+
+constexpr bool IsLocalTimestamp1(uint8_t header) {
+    return (header & 0xCF) == 0xC0;
+}
+
+constexpr bool IsExtensionWithPayload(uint8_t header) {
+    return (header & 0x8B) == 0x88;
+}
+
+inline uint32_t ReadLittleEndian(const uint8_t *bytes, uint8_t size) {
+    switch (size) {
+    case 1:
+        return bytes[0];
+    case 2:
+        return bytes[0] | (uint32_t(bytes[1]) << 8);
+    default:
+        return bytes[0] | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+    }
+}
+
+inline uint32_t TrailingZeros(const uint8_t *bytes, size_t size) {
+    uint32_t zeros = 0;
+    while (zeros < size && bytes[size - 1 - zeros] == 0) {
+        ++zeros;
+    }
+    return zeros;
+}
+
+inline void EmitSourcePacket(uint8_t header, uint8_t size, uint32_t value, ItmPacketBatch &batch) {
+    if ((header & 0x04) == 0) {
+        batch.Push({ItmPacket::Kind::SOFTWARE, static_cast<uint8_t>(header >> 3), size, 0, value});
+    } else if ((header >> 3) == HW_EXCEPTION_TRACE && size == 2) {
+        batch.Push(
+            {ItmPacket::Kind::EXCEPTION, 0, 0, static_cast<uint8_t>((value >> 12) & 0x03), value & 0x1FF}
+        );
+    } else if ((header >> 3) == HW_PC_SAMPLE) {
+        /* A one byte sample is the sleep marker */
+        batch.Push({ItmPacket::Kind::PC_SAMPLE, 0, 0, static_cast<uint8_t>(size == 1), size == 4 ? value : 0});
+    }
+}
+
+}
+
+ItmBlockDecoder::ItmBlockDecoder(bool forceSync) : state_(forceSync ? State::UNSYNCED : State::IDLE) {}
+
+size_t ItmBlockDecoder::Decode(std::span<const uint8_t> data, ItmPacketBatch &batch) {
+    const uint8_t *p = data.data();
+    const uint8_t *const end = p + data.size();
+
+    while (p < end && !batch.full()) {
+        switch (state_) {
+        case State::UNSYNCED:
+            p += ScanForSync(p, static_cast<size_t>(end - p));
+            break;
+
+        case State::IDLE: {
+            const uint8_t header = *p;
+
+            /* Fast path: complete source packets are decoded straight from the buffer */
+            if (IsSourcePacket(header)) {
+                const uint8_t size = PayloadSize(header);
+                if (static_cast<size_t>(end - p) > size) {
+                    EmitSourcePacket(header, size, ReadLittleEndian(p + 1, size), batch);
+                    zeroRun_ = TrailingZeros(p + 1, size);
+                    p += 1 + size;
+                    break;
+                }
+            }
+
+            ++p;
+            StartPacket(header, batch);
+            break;
+        }
+
+        case State::FIXED_PAYLOAD: {
+            const uint8_t byte = *p++;
+            if (TrackSync(byte)) {
+                break;
+            }
+            value_ |= uint32_t(byte) << (8 * received_++);
+            if (received_ == expected_) {
+                FinishFixedPacket(batch);
+            }
+            break;
+        }
+
+        case State::CONTINUATION: {
+            const uint8_t byte = *p++;
+            if (TrackSync(byte)) {
+                break;
+            }
+            if (received_ < 5) {
+                value_ |= uint32_t(byte & 0x7F) << (7 * received_);
+            }
+            if (++received_ == MAX_CONTINUATION_BYTES || (byte & 0x80) == 0) {
+                FinishContinuationPacket(batch);
+            }
+            break;
+        }
+        }
+    }
+
+    return static_cast<size_t>(p - data.data());
+}
+
+bool ItmBlockDecoder::TrackSync(uint8_t byte) {
+    if (byte == 0) {
+        zeroRun_ = std::min(zeroRun_ + 1, SYNC_ZEROS);
+        return false;
+    }
+
+    const bool synced = byte == SYNC_END && zeroRun_ >= SYNC_ZEROS;
+    zeroRun_ = 0;
+    if (synced) {
+        state_ = State::IDLE;
+    }
+    return synced;
+}
+
+size_t ItmBlockDecoder::ScanForSync(const uint8_t *data, size_t size) {
+    const uint8_t *p = data;
+    const uint8_t *const end = data + size;
+
+    /* memchr is vectorised by the C library, which makes skipping unsynced data cheap */
+    while (p < end) {
+        auto *candidate = static_cast<const uint8_t *>(std::memchr(p, SYNC_END, static_cast<size_t>(end - p)));
+        if (!candidate) {
+            const auto zeros = TrailingZeros(p, static_cast<size_t>(end - p));
+            zeroRun_ = std::min(zeros == static_cast<size_t>(end - p) ? zeroRun_ + zeros : zeros, SYNC_ZEROS);
+            return size;
+        }
+
+        const auto window = std::min<size_t>(static_cast<size_t>(candidate - p), SYNC_ZEROS);
+        uint32_t zeros = TrailingZeros(candidate - window, window);
+        if (zeros == static_cast<size_t>(candidate - p)) {
+            zeros += zeroRun_;
+        }
+
+        p = candidate + 1;
+        zeroRun_ = 0;
+
+        if (zeros >= SYNC_ZEROS) {
+            state_ = State::IDLE;
+            break;
+        }
+    }
+
+    return static_cast<size_t>(p - data);
+}
+
+void ItmBlockDecoder::StartPacket(uint8_t header, ItmPacketBatch &batch) {
+    if (TrackSync(header) || header == 0x00) {
+        return;
+    }
+    if (header == OVERFLOW) {
+        batch.Push({ItmPacket::Kind::OVERFLOW, 0, 0, 0, 0});
+        return;
+    }
+
+    header_ = header;
+    received_ = 0;
+    value_ = 0;
+
+    if (IsSourcePacket(header)) {
+        /* The payload continues in the next buffer */
+        expected_ = PayloadSize(header);
+        state_ = State::FIXED_PAYLOAD;
+    } else if ((header & 0x8F) == 0x00) {
+        /* Local timestamp format 2: the increment is in the header itself */
+        batch.Push({ItmPacket::Kind::TIMESTAMP, 0, 0, 0, static_cast<uint32_t>((header >> 4) & 0x07)});
+    } else if (IsLocalTimestamp1(header) || header == GLOBAL_TIMESTAMP_1 || header == GLOBAL_TIMESTAMP_2 ||
+               IsExtensionWithPayload(header)) {
+        state_ = State::CONTINUATION;
+    }
+}
+
+void ItmBlockDecoder::FinishFixedPacket(ItmPacketBatch &batch) {
+    EmitSourcePacket(header_, expected_, value_, batch);
+    state_ = State::IDLE;
+}
+
+void ItmBlockDecoder::FinishContinuationPacket(ItmPacketBatch &batch) {
+    if (IsLocalTimestamp1(header_)) {
+        batch.Push({ItmPacket::Kind::TIMESTAMP, 0, 0, static_cast<uint8_t>((header_ >> 4) & 0x03), value_});
+    }
+    state_ = State::IDLE;
+}
+
+} // namespace orbcat
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace orbcat {
+
+/** A decoded ITM packet, small enough to be stored by value in a preallocated batch */
+struct ItmPacket {
+    enum class Kind : uint8_t { SOFTWARE, TIMESTAMP, EXCEPTION, PC_SAMPLE, OVERFLOW };
+
+    Kind kind;
+    uint8_t channel; /* SOFTWARE: stimulus port */
+    uint8_t size;    /* SOFTWARE: payload length (1, 2 or 4) */
+    uint8_t status;  /* TIMESTAMP: TimeStatus, EXCEPTION: ExceptionEvent, PC_SAMPLE: 1 while sleeping */
+    uint32_t value;  /* SOFTWARE: payload, TIMESTAMP: increment, EXCEPTION: exception number, PC_SAMPLE: PC */
+};
+static_assert(sizeof(ItmPacket) == 8);
+
+class ItmPacketBatch {
+public:
+    /** The smallest ITM packet is a single byte, so this fits every packet of a full receive buffer */
+    static constexpr size_t CAPACITY = 2048;
+
+    ItmPacket *begin() {
+        return packets_.data();
+    }
+    ItmPacket *end() {
+        return packets_.data() + size_;
+    }
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    bool full() const {
+        return size_ == CAPACITY;
+    }
+    void Clear() {
+        size_ = 0;
+    }
+    void Push(const ItmPacket &packet) {
+        packets_[size_++] = packet;
+    }
+
+private:
+    std::array<ItmPacket, CAPACITY> packets_;
+    size_t size_ = 0;
+};
+
+/**
+ * Decodes whole receive buffers of ITM data at once instead of pumping orbuculum's ITMDecoder byte by byte.
+ *
+ * Only the packets Orbcat forwards without a full orbuculum `msg` are emitted: software (SWIT), local timestamp,
+ * exception trace and periodic PC sample packets. Every other packet is skipped with the same framing rules, so the emitted sequence
+ * matches the ITMDecoder path for these packet types. State is carried between calls, so packets may straddle
+ * buffers.
+ */
+class ItmBlockDecoder {
+public:
+    explicit ItmBlockDecoder(bool forceSync = true);
+
+    /**
+     * Decodes as much of `data` as fits into `batch` and returns the number of bytes consumed. Fewer than
+     * `data.size()` bytes are only consumed when the batch fills up.
+     */
+    size_t Decode(std::span<const uint8_t> data, ItmPacketBatch &batch);
+
+    bool IsSynced() const {
+        return state_ != State::UNSYNCED;
+    }
+
+private:
+    enum class State : uint8_t { UNSYNCED, IDLE, FIXED_PAYLOAD, CONTINUATION };
+
+    State state_;
+    uint8_t header_ = 0;
+    uint8_t expected_ = 0; /* FIXED_PAYLOAD: payload length */
+    uint8_t received_ = 0; /* Payload bytes received so far */
+    uint32_t value_ = 0;
+    uint32_t zeroRun_ = 0; /* Consecutive zero bytes seen, used to detect synchronisation packets */
+
+    /** Tracks zero runs, returns true (and resynchronises) when `byte` completes a synchronisation packet */
+    bool TrackSync(uint8_t byte);
+    size_t ScanForSync(const uint8_t *data, size_t size);
+    void StartPacket(uint8_t header, ItmPacketBatch &batch);
+    void FinishFixedPacket(ItmPacketBatch &batch);
+    void FinishContinuationPacket(ItmPacketBatch &batch);
+};
+
+} // namespace orbcat
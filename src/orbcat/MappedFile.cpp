@@ -0,0 +1,48 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace orbcat {
+
+MappedFile::MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            data_ = static_cast<const uint8_t *>(mapping);
+            size_ = static_cast<size_t>(st.st_size);
+            madvise(mapping, size_, MADV_SEQUENTIAL);
+            madvise(mapping, size_, MADV_WILLNEED);
+        }
+    }
+
+    /* The mapping stays valid after the descriptor is closed */
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        munmap(const_cast<uint8_t *>(data_), size_);
+    }
+}
+
+void MappedFile::Release(std::span<const uint8_t> range) const {
+    static const auto pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+    /* Only whole pages inside the range can be dropped */
+    auto begin = (reinterpret_cast<uintptr_t>(range.data()) + pageSize - 1) & ~(pageSize - 1);
+    auto end = (reinterpret_cast<uintptr_t>(range.data()) + range.size()) & ~(pageSize - 1);
+    if (end > begin) {
+        madvise(reinterpret_cast<void *>(begin), end - begin, MADV_DONTNEED);
+    }
+}
+
+} // namespace orbcat
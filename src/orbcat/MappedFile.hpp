@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace orbcat {
+
+/** Read-only memory mapping of a capture file, used to decode offline captures without copying them */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool IsOpen() const {
+        return data_ != nullptr;
+    }
+
+    std::span<const uint8_t> Data() const {
+        return {data_, size_};
+    }
+
+    /** Tells the kernel that `range` has been consumed and its pages can be dropped */
+    void Release(std::span<const uint8_t> range) const;
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace orbcat
@@ -1,5 +1,6 @@
 #include "Orbcat.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <csignal>
 #include <cstdlib>
@@ -10,6 +11,8 @@
 #include <utility>
 
 #include "generics.h"
+#include "ItmBlockDecoder.hpp"
+#include "MappedFile.hpp"
 #include "itmDecoder.h"
 #include "msgDecoder.h"
 #include "msgSeq.h"
@@ -20,12 +23,17 @@ namespace orbcat {
 
 class Orbcat::Impl {
 public:
-    Impl(Options options, MessageHandler handlers) : options_(std::move(options)), handlers_(std::move(handlers)) {}
+    Impl(Options options, MessageHandler handlers) : options_(std::move(options)), handlers_(std::move(handlers)) {
+        initializeDecoders();
+    }
 
     void Start();
     void Stop() {
         running_ = false;
     }
+    void Feed(std::span<const uint8_t> data) {
+        processData(data.data(), data.size());
+    }
 
 private:
     Options options_;
@@ -35,6 +43,9 @@ private:
     struct {
         ITMDecoder itmDecoder{};
         MSGSeq msgSequencer{};
+        ItmBlockDecoder blockDecoder{};
+        ItmPacketBatch packetBatch{};
+        bool useBlockDecoder = false;
 
         uint64_t currentTimestamp = 0;
         uint64_t lastTimestamp = 0;
@@ -44,11 +55,16 @@ private:
 
     void initializeDecoders();
     std::unique_ptr<Stream, void (*)(Stream *)> tryOpenStream();
+    bool canUseBlockDecoder() const;
     void handleTimestamp(const genericMsg &msg);
+    void advanceTimestamp(uint32_t increment);
     void dispatchMessage(const msg &message);
+    void dispatchPacket(const ItmPacket &packet);
     void processByte(uint8_t byte);
-    void processData(uint8_t *data, size_t size);
+    void processData(const uint8_t *data, size_t size);
+    void receiveData(const uint8_t *data, size_t size);
     void feedStream(Stream *stream);
+    void feedMappedFile(const MappedFile &file);
 };
 
 Orbcat::Orbcat(const Orbcat::Options &options, MessageHandler handlers)
@@ -64,10 +80,22 @@ void Orbcat::Stop() {
     pImpl->Stop();
 }
 
+void Orbcat::Feed(std::span<const uint8_t> data) {
+    pImpl->Feed(data);
+}
+
 void Orbcat::Impl::initializeDecoders() {
     // ITMDecoderInit(&decoders_.itmDecoder, options_.itmSync);
     ITMDecoderInit(&decoders_.itmDecoder, true);
     MSGSeqInit(&decoders_.msgSequencer, &decoders_.itmDecoder, 30);
+    decoders_.blockDecoder = ItmBlockDecoder(true);
+    decoders_.useBlockDecoder = canUseBlockDecoder();
+}
+
+bool Orbcat::Impl::canUseBlockDecoder() const {
+    /* The block decoder neither re-sequences target timestamps nor decodes DWT and watchpoint packets */
+    return options_.useBlockDecoder && !IsTargetTimestampMode(options_.timestampMode) && !handlers_.onDwtEvent &&
+           !handlers_.onDataWatchpoint && !handlers_.onDataAccess && !handlers_.onOffsetWrite && !handlers_.onNiSync;
 }
 
 std::unique_ptr<Stream, void (*)(Stream *)> Orbcat::Impl::tryOpenStream() {
@@ -106,14 +134,47 @@ void Orbcat::Impl::feedStream(Stream *stream) {
         }
 
         if (receivedSize > 0) {
-            processData(buffer, receivedSize);
+            receiveData(buffer, receivedSize);
         }
     }
 }
 
-void Orbcat::Impl::processData(uint8_t *data, size_t size) {
-    for (size_t i = 0; i < size; ++i) {
-        processByte(data[i]);
+void Orbcat::Impl::feedMappedFile(const MappedFile &file) {
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    auto remaining = file.Data();
+    while (running_ && !remaining.empty()) {
+        auto chunk = remaining.first(std::min(CHUNK_SIZE, remaining.size()));
+        receiveData(chunk.data(), chunk.size());
+        file.Release(chunk);
+        remaining = remaining.subspan(chunk.size());
+    }
+}
+
+void Orbcat::Impl::receiveData(const uint8_t *data, size_t size) {
+    if (handlers_.onRawData) {
+        handlers_.onRawData({data, size});
+    } else {
+        processData(data, size);
+    }
+}
+
+void Orbcat::Impl::processData(const uint8_t *data, size_t size) {
+    if (!decoders_.useBlockDecoder) {
+        for (size_t i = 0; i < size; ++i) {
+            processByte(data[i]);
+        }
+        return;
+    }
+
+    std::span<const uint8_t> remaining(data, size);
+    auto &batch = decoders_.packetBatch;
+    while (!remaining.empty()) {
+        remaining = remaining.subspan(decoders_.blockDecoder.Decode(remaining, batch));
+        for (const auto &packet : batch) {
+            dispatchPacket(packet);
+        }
+        batch.Clear();
     }
 }
 
@@ -128,12 +189,14 @@ void Orbcat::Impl::processByte(uint8_t byte) {
     the
      * timestamps are   */
     /* issued _before_ the data they apply to.  These are the two cases. */
-    if (options_.timestampMode != TimestampMode::TARGET_CYCLES &&
-        options_.timestampMode != TimestampMode::TARGET_DELTA) {
-        if (ITM_EV_PACKET_RXED == ITMPump(&decoders_.itmDecoder, byte)) {
+    if (!IsTargetTimestampMode(options_.timestampMode)) {
+        const auto event = ITMPump(&decoders_.itmDecoder, byte);
+        if (event == ITM_EV_PACKET_RXED) {
             if (ITMGetDecodedPacket(&decoders_.itmDecoder, &message)) {
                 dispatchMessage(message);
             }
+        } else if (event == ITM_EV_OVERFLOW && handlers_.onOverflow) {
+            handlers_.onOverflow(decoders_.currentTimestamp);
         }
     } else {
         /* Pump messages into the store until we get a time message, then we can
@@ -179,6 +242,15 @@ void Orbcat::Impl::dispatchMessage(const msg &message) {
         }
         break;
 
+    case MSG_PC_SAMPLE:
+        if (handlers_.onPcSample) {
+            handlers_.onPcSample(
+                PcSample{.pc = message.pcSampleMsg.pc, .sleeping = message.pcSampleMsg.sleep},
+                message.pcSampleMsg.ts
+            );
+        }
+        break;
+
     case MSG_DWT_EVENT:
         if (handlers_.onDwtEvent) {
             handlers_.onDwtEvent(message.dwtMsg, message.dwtMsg.ts);
@@ -214,10 +286,56 @@ void Orbcat::Impl::dispatchMessage(const msg &message) {
     }
 }
 
+void Orbcat::Impl::dispatchPacket(const ItmPacket &packet) {
+    switch (packet.kind) {
+    case ItmPacket::Kind::SOFTWARE:
+        if (handlers_.onChannelData) {
+            auto value = packet.value;
+            handlers_.onChannelData(
+                packet.channel, decoders_.currentTimestamp,
+                std::as_writable_bytes(std::span(&value, 1)).first(packet.size)
+            );
+        }
+        break;
+
+    case ItmPacket::Kind::TIMESTAMP:
+        advanceTimestamp(packet.value);
+        break;
+
+    case ItmPacket::Kind::EXCEPTION:
+        if (handlers_.onException) {
+            ExceptionMessage exMsg{
+                .event = static_cast<ExceptionMessage::ExceptionEvent>(packet.status),
+                .exceptionNumber = packet.value,
+            };
+            handlers_.onException(exMsg, decoders_.currentTimestamp);
+        }
+        break;
+
+    case ItmPacket::Kind::PC_SAMPLE:
+        if (handlers_.onPcSample) {
+            handlers_.onPcSample(
+                PcSample{.pc = packet.value, .sleeping = packet.status != 0}, decoders_.currentTimestamp
+            );
+        }
+        break;
+
+    case ItmPacket::Kind::OVERFLOW:
+        if (handlers_.onOverflow) {
+            handlers_.onOverflow(decoders_.currentTimestamp);
+        }
+        break;
+    }
+}
+
 void Orbcat::Impl::handleTimestamp(const genericMsg &msg) {
     auto *tsMsg = reinterpret_cast<const TSMsg *>(&msg);
-    decoders_.currentTimestamp += tsMsg->timeInc;
     // decoders_.timeStatus = static_cast<enum timeDelay>(tsMsg->timeStatus);
+    advanceTimestamp(tsMsg->timeInc);
+}
+
+void Orbcat::Impl::advanceTimestamp(uint32_t increment) {
+    decoders_.currentTimestamp += increment;
 
     if (!decoders_.timestampInitialized) {
         decoders_.lastTimestamp = decoders_.currentTimestamp;
@@ -235,6 +353,15 @@ void Orbcat::Impl::Start() {
 
     initializeDecoders();
 
+    /* Offline captures are decoded straight from a mapping of the file */
+    if (!options_.inputFile.empty() && options_.mapInputFile && options_.endTerminate) {
+        MappedFile file(options_.inputFile);
+        if (file.IsOpen()) {
+            feedMappedFile(file);
+            return;
+        }
+    }
+
     while (running_) {
         auto stream = tryOpenStream();
         if (!stream) {
@@ -26,12 +26,22 @@ enum class TimestampMode {
     TARGET_DELTA   /* Target-based timestamps require message reordering */
 };
 
+constexpr bool IsTargetTimestampMode(TimestampMode mode) {
+    return mode == TimestampMode::TARGET_CYCLES || mode == TimestampMode::TARGET_DELTA;
+}
+
 struct ExceptionMessage {
     enum class ExceptionEvent { RESERVED = 0, ENTER = 1, EXIT = 2, RESUME = 3 };
     ExceptionEvent event;
     uint32_t exceptionNumber;
 };
 
+/** DWT periodic PC sample. While the core sleeps, the DWT sends a sleep marker instead of a PC. */
+struct PcSample {
+    uint32_t pc;
+    bool sleeping;
+};
+
 /* Time conditions of a TS message - from itmDecoder.h */
 enum TimeStatus { TIME_CURRENT = 0, TIME_DELAYED = 1, EVENT_DELAYED = 2, EVENT_AND_TIME_DELAYED = 3 };
 
@@ -39,21 +49,31 @@ class MessageHandler {
 public:
     using ExceptionHandler = std::function<void(const ExceptionMessage &, uint64_t timestamp)>;
     using DwtEventHandler = std::function<void(const dwtMsg &, uint64_t timestamp)>;
+    using PcSampleHandler = std::function<void(const PcSample &, uint64_t timestamp)>;
     using DataWatchpointHandler = std::function<void(const watchMsg &, uint64_t timestamp)>;
     using DataAccessHandler = std::function<void(const wptMsg &, uint64_t timestamp)>;
     using OffsetWriteHandler = std::function<void(const oswMsg &, uint64_t timestamp)>;
     using NiSyncHandler = std::function<void(const nisyncMsg &, uint64_t timestamp)>;
     using TimestampHandler = std::function<void(uint64_t timestamp, TimeStatus status)>;
+    using OverflowHandler = std::function<void(uint64_t timestamp)>;
     using ChannelDataHandler = std::function<void(uint8_t channel, uint64_t timestamp, std::span<std::byte> data)>;
+    using RawDataHandler = std::function<void(std::span<const uint8_t> data)>;
 
     ExceptionHandler onException;
     DwtEventHandler onDwtEvent;
+    PcSampleHandler onPcSample;
     DataWatchpointHandler onDataWatchpoint;
     DataAccessHandler onDataAccess;
     OffsetWriteHandler onOffsetWrite;
     NiSyncHandler onNiSync;
     TimestampHandler onTimestamp;
+    /* The ITM dropped packets because its FIFO was full */
+    OverflowHandler onOverflow;
     ChannelDataHandler onChannelData;
+
+    /* When set, received data is handed over undecoded and must be passed to Orbcat::Feed, usually from another
+     * thread */
+    RawDataHandler onRawData;
 };
 
 class Orbcat {
@@ -72,6 +92,14 @@ public:
 
         bool useTPIU = false;
         bool enableInstructionTrace = false;
+
+        /* Decode whole receive buffers with ItmBlockDecoder. Falls back to orbuculum's ITMDecoder when target
+         * timestamps or DWT/watchpoint handlers need it. */
+        bool useBlockDecoder = true;
+
+        /* Memory-map inputFile instead of reading it through a stream. Only used when endTerminate is set, since
+         * a mapping does not follow a file that is still being written. */
+        bool mapInputFile = true;
     };
 
     Orbcat(const Options &options, MessageHandler handlers);
@@ -79,6 +107,9 @@ public:
     void Start();
     void Stop();
 
+    /** Decodes `data` and calls the message handlers. Used together with MessageHandler::onRawData. */
+    void Feed(std::span<const uint8_t> data);
+
 private:
     class Impl;
     std::unique_ptr<Impl> pImpl;
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ItmBlockDecoder.hpp"
+#include "Orbcat.hpp"
+
+namespace orbcat {
+
+/**
+ * Receiver of decoded ITM packets for ItmDemux and StaticOrbcat. OnChannelData is required, OnTimestamp,
+ * OnException, OnPcSample and OnOverflow are called only when the sink has them.
+ */
+template <typename Sink>
+concept ItmSink = requires(Sink &sink, uint8_t channel, uint64_t timestamp, std::span<const std::byte> data) {
+    sink.OnChannelData(channel, timestamp, data);
+};
+
+/**
+ * Decodes ITM data with ItmBlockDecoder and calls the sink directly, so the callbacks can be inlined.
+ *
+ * A local timestamp is sent after the packets it applies to. With `sequenceTimestamps`, packets are held back until
+ * their timestamp arrives (like orbuculum's MSGSeq), which gives e.g. exception trace exact times. Otherwise packets
+ * are passed on at once with the previous timestamp.
+ */
+template <ItmSink Sink>
+class ItmDemux {
+public:
+    explicit ItmDemux(Sink &sink, bool sequenceTimestamps = false)
+        : sink_(sink), sequenceTimestamps_(sequenceTimestamps) {}
+
+    void Feed(std::span<const uint8_t> data) {
+        while (!data.empty()) {
+            data = data.subspan(decoder_.Decode(data, batch_));
+            for (const auto &packet : batch_) {
+                if (!sequenceTimestamps_ || packet.kind == ItmPacket::Kind::TIMESTAMP) {
+                    Dispatch(packet);
+                } else {
+                    pending_.push_back(packet);
+                    if (pending_.size() == MAX_PENDING) {
+                        /* Timestamps are not enabled on the target, or got lost */
+                        Flush();
+                    }
+                }
+            }
+            batch_.Clear();
+        }
+    }
+
+    /** Passes on the packets that are still waiting for a timestamp */
+    void Flush() {
+        for (const auto &packet : pending_) {
+            Dispatch(packet);
+        }
+        pending_.clear();
+    }
+
+    uint64_t CurrentTimestamp() const {
+        return currentTimestamp_;
+    }
+
+private:
+    static constexpr size_t MAX_PENDING = 64;
+
+    Sink &sink_;
+    ItmBlockDecoder decoder_{true};
+    ItmPacketBatch batch_;
+    uint64_t currentTimestamp_ = 0;
+    bool sequenceTimestamps_;
+    std::vector<ItmPacket> pending_;
+
+    void Dispatch(const ItmPacket &packet) {
+        switch (packet.kind) {
+        case ItmPacket::Kind::SOFTWARE:
+            sink_.OnChannelData(
+                packet.channel, currentTimestamp_, std::as_bytes(std::span(&packet.value, 1)).first(packet.size)
+            );
+            break;
+
+        case ItmPacket::Kind::TIMESTAMP:
+            currentTimestamp_ += packet.value;
+            Flush();
+            if constexpr (requires { sink_.OnTimestamp(currentTimestamp_, TimeStatus::TIME_CURRENT); }) {
+                sink_.OnTimestamp(currentTimestamp_, static_cast<TimeStatus>(packet.status));
+            }
+            break;
+
+        case ItmPacket::Kind::EXCEPTION:
+            if constexpr (requires(const ExceptionMessage &exception) { sink_.OnException(exception, uint64_t{}); }) {
+                sink_.OnException(
+                    ExceptionMessage{
+                        .event = static_cast<ExceptionMessage::ExceptionEvent>(packet.status),
+                        .exceptionNumber = packet.value,
+                    },
+                    currentTimestamp_
+                );
+            }
+            break;
+
+        case ItmPacket::Kind::PC_SAMPLE:
+            if constexpr (requires(const PcSample &sample) { sink_.OnPcSample(sample, uint64_t{}); }) {
+                sink_.OnPcSample(PcSample{.pc = packet.value, .sleeping = packet.status != 0}, currentTimestamp_);
+            }
+            break;
+
+        case ItmPacket::Kind::OVERFLOW:
+            if constexpr (requires { sink_.OnOverflow(uint64_t{}); }) {
+                sink_.OnOverflow(currentTimestamp_);
+            }
+            break;
+        }
+    }
+};
+
+/**
+ * Orbcat front end templated on a sink instead of std::function handlers. Orbcat only receives the data; every
+ * packet is then dispatched to the sink without an indirect call.
+ *
+ * Always uses the block decoder, so Options::useBlockDecoder is ignored. The target timestamp modes re-sequence
+ * packets in ItmDemux.
+ */
+template <ItmSink Sink>
+class StaticOrbcat {
+public:
+    StaticOrbcat(const Orbcat::Options &options, Sink &sink)
+        : demux_(sink, IsTargetTimestampMode(options.timestampMode)),
+          orbcat_(options, MessageHandler{.onRawData = [this](std::span<const uint8_t> data) {
+                      demux_.Feed(data);
+                  }}) {}
+
+    void Start() {
+        orbcat_.Start();
+        demux_.Flush();
+    }
+
+    void Stop() {
+        orbcat_.Stop();
+    }
+
+private:
+    ItmDemux<Sink> demux_;
+    Orbcat orbcat_;
+};
+
+} // namespace orbcat
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Packet.hpp"
+#include "Track.hpp"
+
+namespace profiler {
+
+/**
+ * How the values of a counter are shown, set by PlotConfig. The type is the target's plot format. Perfetto always
+ * draws counters as filled steps in a colour of its own choosing, so the rest of the target's config is not kept.
+ */
+struct CounterConfig {
+    enum class Type : int32_t { NUMBER, MEMORY, PERCENTAGE, WATT };
+
+    Type type = Type::NUMBER;
+};
+
+/**
+ * Counter tracks, created when a counter is first updated and looked up by name and object handle in a flat map.
+ *
+ * Only the last value per timestamp is written: an update is held back until time moves on, when the caller flushes
+ * the store with FlushBefore. Updates share a timestamp when they come from one message, such as a queue send with
+ * the depth of the queue and of the task's messages; with cycle-accurate timestamps, separate messages rarely do.
+ */
+class CounterStore {
+public:
+    static CounterStore &Instance() {
+        static CounterStore instance;
+        return instance;
+    }
+
+    /**
+     * Sets `name` of `handle` to `value`. A new track is called `displayName` and placed under `parent`, the root
+     * track when none is given.
+     */
+    void Update(
+        std::string_view name,
+        uint32_t handle,
+        int64_t value,
+        uint64_t timestamp,
+        std::string_view displayName = {},
+        const TrackNode *parent = nullptr
+    ) {
+        const size_t index = FindOrCreate(name, handle, displayName, parent);
+        auto &counter = counters_[index];
+        if (!counter.pending) {
+            pending_.push_back(index);
+        } else if (counter.pendingTimestamp != timestamp) {
+            Write(counter);
+        }
+        counter.pending = true;
+        counter.pendingTimestamp = timestamp;
+        counter.pendingValue = value;
+    }
+
+    /** Applies `config` to every track of `name`, including those that are created later */
+    void Configure(std::string_view name, const CounterConfig &config) {
+        auto it = std::ranges::find(configs_, name, &NamedConfig::name);
+        if (it == configs_.end()) {
+            configs_.push_back({std::string(name), config});
+        } else {
+            it->config = config;
+        }
+        for (auto &counter : counters_) {
+            if (counter.name == name) {
+                counter.config = config;
+                Describe(counter);
+            }
+        }
+    }
+
+    /** Writes the values that are held back from before `timestamp`, which are final once time has moved on */
+    void FlushBefore(uint64_t timestamp) {
+        std::erase_if(pending_, [&](size_t index) {
+            auto &counter = counters_[index];
+            if (counter.pending && counter.pendingTimestamp < timestamp) {
+                Write(counter);
+            }
+            return !counter.pending;
+        });
+    }
+
+    /** Writes all values that are held back */
+    void Flush() {
+        FlushBefore(UINT64_MAX);
+    }
+
+    size_t Count() const {
+        return counters_.size();
+    }
+
+private:
+    struct Counter {
+        uint32_t handle;
+        std::string name;
+        std::string displayName;
+        uint64_t trackId;
+        uint64_t parentId;
+        CounterConfig config;
+        bool pending = false;
+        uint64_t pendingTimestamp = 0;
+        int64_t pendingValue = 0;
+    };
+
+    struct NamedConfig {
+        std::string name;
+        CounterConfig config;
+    };
+
+    /* Sorted by handle and then name */
+    std::vector<Counter> counters_;
+    std::vector<NamedConfig> configs_;
+    /* Indices of the counters with a value held back */
+    std::vector<size_t> pending_;
+
+    CounterStore() = default;
+
+    static bool Less(const Counter &counter, std::pair<uint32_t, std::string_view> key) {
+        return counter.handle != key.first ? counter.handle < key.first : std::string_view(counter.name) < key.second;
+    }
+
+    /** Returns the index of the counter */
+    size_t
+    FindOrCreate(std::string_view name, uint32_t handle, std::string_view displayName, const TrackNode *parent) {
+        const std::pair key{handle, name};
+        auto it = std::lower_bound(counters_.begin(), counters_.end(), key, Less);
+        const auto index = static_cast<size_t>(it - counters_.begin());
+        if (it != counters_.end() && it->handle == handle && it->name == name) {
+            return index;
+        }
+
+        auto &tracks = TrackManager::Instance();
+        tracks.Initialize();
+        Counter counter{
+            .handle = handle,
+            .name = std::string(name),
+            .displayName = std::string(displayName.empty() ? name : displayName),
+            .trackId = GenerateUniqueUuid(),
+            .parentId = parent ? parent->id : tracks.root->id,
+        };
+        if (auto config = std::ranges::find(configs_, name, &NamedConfig::name); config != configs_.end()) {
+            counter.config = config->config;
+        }
+        it = counters_.insert(it, std::move(counter));
+        for (auto &pending : pending_) {
+            pending += pending >= index;
+        }
+        Describe(*it);
+        return index;
+    }
+
+    /** Writes the track descriptor, again when the config changes */
+    static void Describe(const Counter &counter) {
+        using perfetto::protos::pbzero::CounterDescriptor;
+        EmitPacket(GetTime(), [&](auto &packet, SequenceState &) {
+            auto *trackDesc = packet->set_track_descriptor();
+            trackDesc->set_uuid(counter.trackId);
+            trackDesc->set_name(counter.displayName);
+            trackDesc->set_parent_uuid(counter.parentId);
+            auto *counterDesc = trackDesc->set_counter();
+            switch (counter.config.type) {
+            case CounterConfig::Type::MEMORY:
+                counterDesc->set_unit(CounterDescriptor::UNIT_SIZE_BYTES);
+                break;
+            case CounterConfig::Type::PERCENTAGE:
+                counterDesc->set_unit_name("%");
+                break;
+            case CounterConfig::Type::WATT:
+                counterDesc->set_unit_name("W");
+                break;
+            case CounterConfig::Type::NUMBER:
+            default:
+                counterDesc->set_unit(CounterDescriptor::UNIT_COUNT);
+                break;
+            }
+        });
+    }
+
+    void Write(Counter &counter) {
+        EmitPacket(counter.pendingTimestamp, [&](auto &packet, SequenceState &) {
+            auto *event = packet->set_track_event();
+            event->set_type(perfetto::protos::pbzero::TrackEvent::TYPE_COUNTER);
+            event->set_track_uuid(counter.trackId);
+            event->set_counter_value(counter.pendingValue);
+        });
+        counter.pending = false;
+    }
+};
+
+}
@@ -1,51 +1,199 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <perfetto.h>
+#include <span>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
 
 #include "TimeUtils.hpp"
 
 namespace profiler {
 
-class ThreadDataSource : public perfetto::DataSource<ThreadDataSource> {
+/** Interning ids of strings that have been written to the current sequence, starting at 1 */
+class InternTable {
 public:
+    /** Returns the id of `text`, and whether it is new and has to be written as interned data */
+    std::pair<uint64_t, bool> Intern(std::string_view text) {
+        auto it = ids_.find(text);
+        if (it != ids_.end()) {
+            return {it->second, false};
+        }
+        const uint64_t id = ids_.size() + 1;
+        ids_.emplace(text, id);
+        return {id, true};
+    }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const {
+            return std::hash<std::string_view>{}(text);
+        }
+    };
+
+    std::unordered_map<std::string, uint64_t, Hash, std::equal_to<>> ids_;
+};
+
+/**
+ * Incremental state of a trace sequence. Perfetto creates a new one when the sequence starts and whenever the
+ * service asks for the state to be cleared; the first packet after that has to say so.
+ *
+ * Packets are timestamped in the TraceClock, as a delta to the previous packet of the sequence. The clock is
+ * declared with a ClockSnapshot against boot time at the start of the sequence, and again when its unit changes.
+ */
+struct SequenceState {
+    /* Sequence-scoped clock ids start at 64, a new one is used when the unit changes */
+    static constexpr uint32_t FIRST_CLOCK_ID = 64;
+    static constexpr uint32_t LAST_CLOCK_ID = 127;
+
+    InternTable eventNames;
+    InternTable annotationNames;
+
+    bool clockDeclared = false;
+    uint32_t clockGeneration = 0;
+    uint64_t clockUnitNs = 1;
+    uint64_t lastTimestamp = 0; /* In clock units */
+
+    /** Timestamp of the next packet in clock units, relative to the previous one. Time never goes backwards. */
+    uint64_t TakeTimestampDelta(uint64_t nanoseconds) {
+        const uint64_t timestamp = std::max(nanoseconds / clockUnitNs, lastTimestamp);
+        const uint64_t delta = timestamp - lastTimestamp;
+        lastTimestamp = timestamp;
+        return delta;
+    }
+};
+struct ThreadDataSourceTraits : public perfetto::DefaultDataSourceTraits {
+    using IncrementalStateType = SequenceState;
+};
+
+class ThreadDataSource : public perfetto::DataSource<ThreadDataSource, ThreadDataSourceTraits> {
+public:
+    /* Offline decoding produces data faster than it is written out. Waiting is better than losing packets. */
+    static constexpr perfetto::BufferExhaustedPolicy kBufferExhaustedPolicy = perfetto::BufferExhaustedPolicy::kStall;
+
     void OnSetup(const SetupArgs &) override {}
     void OnStart(const StartArgs &) override {}
     void OnStop(const StopArgs &) override {}
 };
 
-inline auto CreatePacket(uint64_t timestamp = GetTime())
-    -> protozero::MessageHandle<perfetto::protos::pbzero::TracePacket> {
-    protozero::MessageHandle<perfetto::protos::pbzero::TracePacket> packet;
-    ThreadDataSource::Trace([&packet, timestamp](ThreadDataSource::TraceContext ctx) {
-        packet = ctx.NewTracePacket();
-        packet->set_timestamp(timestamp);
+/** Starts the sequence over with the current TraceClock, declared at `nanoseconds` */
+template <typename TraceContext>
+inline void DeclareTraceClock(TraceContext &ctx, SequenceState &state, uint64_t nanoseconds) {
+    using perfetto::protos::pbzero::TracePacket;
+    const auto &clock = GetTraceClock();
+    const uint32_t clockId = SequenceState::FIRST_CLOCK_ID +
+                             std::min(clock.generation, SequenceState::LAST_CLOCK_ID - SequenceState::FIRST_CLOCK_ID);
+
+    /* Interned ids are dropped along with the old clock, since the sequence is cleared */
+    state = SequenceState{};
+    state.clockDeclared = true;
+    state.clockGeneration = clock.generation;
+    state.clockUnitNs = clock.unitNs;
+    state.lastTimestamp = nanoseconds / clock.unitNs;
+
+    auto packet = ctx.NewTracePacket();
+    packet->set_sequence_flags(TracePacket::SEQ_INCREMENTAL_STATE_CLEARED);
+    auto *snapshot = packet->set_clock_snapshot();
+    auto *bootTime = snapshot->add_clocks();
+    bootTime->set_clock_id(perfetto::protos::pbzero::BUILTIN_CLOCK_BOOTTIME);
+    bootTime->set_timestamp(state.lastTimestamp * clock.unitNs);
+    auto *traceClock = snapshot->add_clocks();
+    traceClock->set_clock_id(clockId);
+    traceClock->set_timestamp(state.lastTimestamp);
+    traceClock->set_unit_multiplier_ns(clock.unitNs);
+    traceClock->set_is_incremental(true);
+    packet->set_trace_packet_defaults()->set_timestamp_clock_id(clockId);
+}
+
+/**
+ * Writes one packet, filled in by `fill(packet, sequenceState)`, straight into the trace writer that the SDK keeps for
+ * this thread and session. The packet is finalized when `fill` returns. Nothing is written while no session is
+ * running.
+ */
+template <typename Fill>
+inline void EmitPacket(uint64_t timestamp, Fill &&fill) {
+    ThreadDataSource::Trace([&](ThreadDataSource::TraceContext ctx) {
+        auto &state = *ctx.GetIncrementalState();
+        if (!state.clockDeclared || state.clockGeneration != GetTraceClock().generation) {
+            DeclareTraceClock(ctx, state, timestamp);
+        }
+
+        auto packet = ctx.NewTracePacket();
+        packet->set_sequence_flags(perfetto::protos::pbzero::TracePacket::SEQ_NEEDS_INCREMENTAL_STATE);
+        packet->set_timestamp(state.TakeTimestampDelta(timestamp));
+        fill(packet, state);
     });
-    if (!packet) {
-        throw std::runtime_error("Failed to create packet");
-    }
-    return packet;
 }
 
+/** An integer argument of a track event, shown in the Perfetto UI's details panel */
+struct DebugArg {
+    std::string_view name;
+    int64_t value;
+};
+
+/**
+ * Writes a track event with interned names, so that a name is only written once per sequence. Anything that varies
+ * between events of the same kind belongs in `args` rather than in the name. One-off text, such as a console line,
+ * is written inline with `internName` false instead, since every interned name is kept for the whole sequence.
+ */
 inline void CreateTrackEvent(
     uint64_t trackUuid,
     uint64_t timestamp,
     perfetto::protos::pbzero::TrackEvent::Type eventType,
-    std::string_view name = {}
+    std::string_view name = {},
+    std::span<const DebugArg> args = {},
+    bool internName = true
 ) {
-    auto packet = CreatePacket(timestamp);
-    // packet->set_trusted_packet_sequence_id(1);
-    auto *event = packet->set_track_event();
-    event->set_type(eventType);
-    event->set_track_uuid(trackUuid);
-    if (!name.empty()) {
-        event->set_name(std::string(name));
-    }
+    EmitPacket(timestamp, [&](auto &packet, SequenceState &state) {
+        /* Interned data has to be written before the event, which is the next nested message */
+        perfetto::protos::pbzero::InternedData *interned = nullptr;
+        auto internedData = [&] {
+            return interned ? interned : (interned = packet->set_interned_data());
+        };
+
+        uint64_t nameIid = 0;
+        if (!name.empty() && internName) {
+            auto [iid, isNew] = state.eventNames.Intern(name);
+            nameIid = iid;
+            if (isNew) {
+                auto *eventName = internedData()->add_event_names();
+                eventName->set_iid(iid);
+                eventName->set_name(name.data(), name.size());
+            }
+        }
 
-    // ThreadDataSource::Trace([](ThreadDataSource::TraceContext ctx) {
-    //     ctx.Flush();
-    // });
+        constexpr size_t MAX_ARGS = 8;
+        uint64_t argIids[MAX_ARGS];
+        const size_t argCount = std::min(args.size(), MAX_ARGS);
+        for (size_t i = 0; i < argCount; ++i) {
+            auto [iid, isNew] = state.annotationNames.Intern(args[i].name);
+            argIids[i] = iid;
+            if (isNew) {
+                auto *annotationName = internedData()->add_debug_annotation_names();
+                annotationName->set_iid(iid);
+                annotationName->set_name(args[i].name.data(), args[i].name.size());
+            }
+        }
+
+        auto *event = packet->set_track_event();
+        event->set_type(eventType);
+        event->set_track_uuid(trackUuid);
+        if (nameIid) {
+            event->set_name_iid(nameIid);
+        } else if (!name.empty()) {
+            event->set_name(name.data(), name.size());
+        }
+        for (size_t i = 0; i < argCount; ++i) {
+            auto *annotation = event->add_debug_annotations();
+            annotation->set_name_iid(argIids[i]);
+            annotation->set_int_value(args[i].value);
+        }
+    });
 }
 
-}
\ No newline at end of file
+}
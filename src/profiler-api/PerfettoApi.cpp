@@ -1,12 +1,13 @@
 #include "PerfettoApi.hpp"
 
 #include <atomic>
+#include <cstdio>
 #include <fcntl.h>
-#include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <unistd.h>
 
+#include "Counter.hpp"
 #include "Logging.hpp"
 #include "spor-devices/DeviceInfo.hpp"
 #include "symbol-resolver/SymbolResolver.hpp"
@@ -30,7 +31,10 @@ namespace profiler {
 std::unordered_map<uint32_t, Lockable> PerfettoApi::lockables;
 std::unordered_map<uint32_t, Thread> PerfettoApi::threads;
 std::unique_ptr<SymbolResolver> PerfettoApi::symbolResolver = nullptr;
+std::shared_ptr<TrackNode> PerfettoApi::dataLossTrack;
 uint32_t PerfettoApi::currentThreadId = 0;
+int PerfettoApi::outputFd = -1;
+std::string PerfettoApi::outputPath;
 
 void InitializePerfetto() {
     perfetto::TracingInitArgs args;
@@ -43,13 +47,23 @@ void InitializePerfetto() {
     ThreadDataSource::Register(dsd);
 }
 
-std::unique_ptr<perfetto::TracingSession> PerfettoApi::StartTracing() {
+std::unique_ptr<perfetto::TracingSession> PerfettoApi::StartTracing(const std::string &outputFile) {
+    outputFd = open(outputFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (outputFd < 0) {
+        throw std::runtime_error("Failed to open trace output file " + outputFile);
+    }
+    outputPath = outputFile;
+
     InitializePerfetto();
     perfetto::TraceConfig cfg;
 
+    /* The buffer only has to hold what is produced between two file writes, the trace itself goes to the file */
     auto *buffer = cfg.add_buffers();
-    buffer->set_size_kb(100 * 1024);
-    // buffer->set_fill_policy(perfetto::TraceConfig::BufferConfig::RING_BUFFER);
+    buffer->set_size_kb(BUFFER_SIZE_KB);
+
+    cfg.set_write_into_file(true);
+    cfg.set_file_write_period_ms(FILE_WRITE_PERIOD_MS);
+    cfg.set_flush_period_ms(FLUSH_PERIOD_MS);
 
     {
         auto *ds_cfg = cfg.add_data_sources()->mutable_config();
@@ -60,15 +74,12 @@ std::unique_ptr<perfetto::TracingSession> PerfettoApi::StartTracing() {
         ds_cfg->set_name("track_event");
     }
 
-    // cfg.set_output_path("output.pftrace");
-    // cfg.set_write_into_file(true);
-
     // perfetto::protos::gen::TrackEventConfig te_cfg;
     // te_cfg.add_enabled_categories("*");
     // ds_cfg->set_track_event_config_raw(te_cfg.SerializeAsString());
 
     auto tracing_session = perfetto::Tracing::NewTrace();
-    tracing_session->Setup(cfg);
+    tracing_session->Setup(cfg, outputFd);
     tracing_session->StartBlocking();
     return tracing_session;
 }
@@ -77,24 +88,21 @@ void PerfettoApi::StopTracing(std::unique_ptr<perfetto::TracingSession> tracing_
     // Flush all pending events
     // perfetto::TrackEvent::Flush();
 
+    CounterStore::Instance().Flush();
     ThreadDataSource::Trace([](ThreadDataSource::TraceContext ctx) {
         ctx.Flush();
     });
 
+    /* Writes out whatever is still in the buffer */
     tracing_session->StopBlocking();
-    std::vector<char> trace_data(tracing_session->ReadTraceBlocking());
-
-    std::ofstream output;
-    const char *filename = "/Users/egill/spor/data/trace.perfetto";
-    output.open(filename, std::ios::out | std::ios::binary);
-    output.write(&trace_data[0], static_cast<std::streamsize>(trace_data.size()));
-    output.close();
+    close(outputFd);
+    outputFd = -1;
 
     for (auto &thread : PerfettoApi::threads) {
         std::cout << thread.second.name << " " << thread.second.pid << std::endl;
     }
 
-    PERFETTO_LOG("Trace written to %s", filename);
+    PERFETTO_LOG("Trace written to %s", outputPath.c_str());
 }
 
 void PerfettoApi::CreateThread(uint32_t threadId, std::string_view threadName) {
@@ -152,58 +160,61 @@ void PerfettoApi::SwitchToThread(uint32_t threadId, std::string_view threadName)
 void PerfettoApi::ZoneBegin(
     std::string_view name, std::string_view function, std::string_view file, uint32_t line, uint32_t color
 ) {
-    // DEBUG_FUNCTION(name, function, file, line, color);
-    //
-    // Thread *thread = currentThreadId != 0 ? FindThread(currentThreadId) : nullptr;
-    // if (thread) {
-    //     auto callStackTrack = thread->GetOrCreateTrack(TrackType::CALL_STACK, "Call Stack");
-    //     if (callStackTrack) {
-    //         callStackTrack->StartSlice(std::string(name), GetTime());
-    //     }
-    // }
+    DEBUG_FUNCTION(name);
+
+    Thread *thread = currentThreadId != 0 ? FindThread(currentThreadId) : nullptr;
+    if (!thread) {
+        return;
+    }
+    if (!thread->zoneTrack) {
+        thread->zoneTrack = TrackManager::Instance().CreateTrack(TrackType::CALL_STACK, "Zones", thread->rootTrack);
+    }
+    /* Zones are nested per task, so slices on the task's own track nest by themselves */
+    thread->zoneStack.push_back(thread->zoneTrack->StartSlice(name, GetTime()));
 }
 
 void PerfettoApi::ZoneEnd() {
     DEBUG_FUNCTION();
 
-    // Thread *thread = currentThreadId != 0 ? FindThread(currentThreadId) : nullptr;
-    // if (thread) {
-    //     auto callStackTrack = thread->GetOrCreateTrack(TrackType::CALL_STACK, "Call Stack");
-    //     if (callStackTrack && callStackTrack->GetActiveSliceCount() > 0) {
-    //         callStackTrack->EndAllSlices();
-    //     }
-    // }
+    Thread *thread = currentThreadId != 0 ? FindThread(currentThreadId) : nullptr;
+    if (thread && !thread->zoneStack.empty()) {
+        SliceStore::Instance().End(thread->zoneStack.back(), GetTime());
+        thread->zoneStack.pop_back();
+    }
 }
 
-void PerfettoApi::Plot(std::string_view name, int64_t value) {
-    DEBUG_FUNCTION(name, value);
+void PerfettoApi::Plot(std::string_view name, int64_t value, uint32_t handle) {
+    DEBUG_FUNCTION(name, value, handle);
 
-    // static std::unordered_map<std::string, perfetto::CounterTrack> counterTracks;
-    //
-    // std::string nameStr(name);
-    // auto it = counterTracks.find(nameStr);
-    // if (it == counterTracks.end()) {
-    //     perfetto::CounterTrack track(perfetto::DynamicString{nameStr});
-    //     auto desc = track.Serialize();
-    //     desc.set_name(nameStr);
-    //     perfetto::TrackEvent::SetTrackDescriptor(track, desc);
-    //     counterTracks.emplace(nameStr, track);
-    //     it = counterTracks.find(nameStr);
-    // }
+    auto &counters = CounterStore::Instance();
+    if (handle == 0) {
+        counters.Update(name, 0, value, GetTime());
+        return;
+    }
 
-    // TRACE_COUNTER("zones", it->second, GetTime(), value);
+    /* A task's counters go under the task, an object's are named after it */
+    if (auto thread = threads.find(handle); thread != threads.end()) {
+        counters.Update(name, handle, value, GetTime(), name, thread->second.rootTrack.get());
+    } else if (auto it = lockables.find(handle); it != lockables.end()) {
+        counters.Update(name, handle, value, GetTime(), it->second.name + " " + std::string(name));
+    } else {
+        char displayName[128];
+        std::snprintf(
+            displayName, sizeof(displayName), "%.*s 0x%08x", static_cast<int>(name.size()), name.data(), handle
+        );
+        counters.Update(name, handle, value, GetTime(), displayName);
+    }
 }
 
-void PerfettoApi::PlotConfig(std::string_view name, int type, bool step, bool fill, uint32_t color) {
-    DEBUG_FUNCTION(name, type, step, fill, color);
+void PerfettoApi::SetTime(uint64_t nanoseconds) {
+    profiler::SetTime(nanoseconds);
+    CounterStore::Instance().FlushBefore(GetTime());
 }
 
-void PerfettoApi::Alloc(const void *ptr, size_t size, std::string_view name) {
-    DEBUG_FUNCTION(ptr, size, name);
-}
+void PerfettoApi::PlotConfig(std::string_view name, int type, bool step, bool fill, uint32_t color) {
+    DEBUG_FUNCTION(name, type, step, fill, color);
 
-void PerfettoApi::Free(const void *ptr, std::string_view name) {
-    DEBUG_FUNCTION(ptr, name);
+    CounterStore::Instance().Configure(name, {.type = static_cast<CounterConfig::Type>(type)});
 }
 
 void PerfettoApi::Message(std::string_view text, bool isConsole) {
@@ -214,7 +225,7 @@ void PerfettoApi::Message(std::string_view text, bool isConsole) {
     if (thread) {
         if (isConsole) {
             if (thread->messageTrack) {
-                thread->messageTrack->Message(text);
+                thread->messageTrack->Text(text);
             }
         } else {
             if (thread->extraInfoTrack) {
@@ -226,6 +237,15 @@ void PerfettoApi::Message(std::string_view text, bool isConsole) {
     }
 }
 
+void PerfettoApi::Message(std::string_view text, std::initializer_list<DebugArg> args) {
+    DEBUG_FUNCTION(text);
+
+    Thread *thread = currentThreadId != 0 ? FindThread(currentThreadId) : nullptr;
+    if (thread && thread->extraInfoTrack) {
+        thread->extraInfoTrack->Message(text, std::span(args.begin(), args.size()));
+    }
+}
+
 void PerfettoApi::SetupLockableIfNeeded(uint32_t id) {
     DEBUG_FUNCTION(id);
     auto it = lockables.find(id);
@@ -423,13 +443,14 @@ void PerfettoApi::FlowBegin(uint32_t flow_id, std::string_view name) {
 
     Thread *thread = currentThreadId != 0 ? FindThread(currentThreadId) : nullptr;
     if (thread && thread->rootTrack) {
-        uint64_t timestamp = GetTime();
-        auto packet = CreatePacket(timestamp);
-        auto *event = packet->set_track_event();
-        event->set_type(perfetto::protos::pbzero::TrackEvent::TYPE_INSTANT);
-        event->set_track_uuid(thread->rootTrack->id);
-        event->set_name(name.empty() ? "Flow Start" : std::string(name));
-        event->add_flow_ids(flow_id);
+        const std::string_view eventName = name.empty() ? "Flow Start" : name;
+        EmitPacket(GetTime(), [&](auto &packet, SequenceState &) {
+            auto *event = packet->set_track_event();
+            event->set_type(perfetto::protos::pbzero::TrackEvent::TYPE_INSTANT);
+            event->set_track_uuid(thread->rootTrack->id);
+            event->set_name(eventName.data(), eventName.size());
+            event->add_flow_ids(flow_id);
+        });
     }
 }
 
@@ -438,14 +459,24 @@ void PerfettoApi::FlowEnd(uint32_t flow_id, std::string_view name) {
 
     Thread *thread = currentThreadId != 0 ? FindThread(currentThreadId) : nullptr;
     if (thread && thread->rootTrack) {
-        uint64_t timestamp = GetTime();
-        auto packet = CreatePacket(timestamp);
-        auto *event = packet->set_track_event();
-        event->set_type(perfetto::protos::pbzero::TrackEvent::TYPE_INSTANT);
-        event->set_track_uuid(thread->rootTrack->id);
-        event->set_name(name.empty() ? "Flow End" : std::string(name));
-        event->add_terminating_flow_ids(flow_id);
+        const std::string_view eventName = name.empty() ? "Flow End" : name;
+        EmitPacket(GetTime(), [&](auto &packet, SequenceState &) {
+            auto *event = packet->set_track_event();
+            event->set_type(perfetto::protos::pbzero::TrackEvent::TYPE_INSTANT);
+            event->set_track_uuid(thread->rootTrack->id);
+            event->set_name(eventName.data(), eventName.size());
+            event->add_terminating_flow_ids(flow_id);
+        });
+    }
+}
+
+void PerfettoApi::DataLost(std::string_view description) {
+    DEBUG_FUNCTION(description);
+
+    if (!dataLossTrack) {
+        dataLossTrack = TrackManager::Instance().CreateTrack(TrackType::CUSTOM, "Data lost");
     }
+    dataLossTrack->Text(description);
 }
 
 }
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <cstring>
 #include <functional>
+#include <initializer_list>
 #include <memory>
 #include <optional>
 #include <perfetto.h>
@@ -27,25 +28,17 @@ struct Lockable {
         : name(std::move(name)), type(std::move(type)), count(count) {}
 
 private:
-    std::optional<std::shared_ptr<Slice>> currentSlice;
+    SliceHandle currentSlice;
 
 public:
-    std::optional<std::shared_ptr<Slice>> GetCurrentSlice() const {
-        return currentSlice;
-    }
-
-    void SetCurrentSlice(std::shared_ptr<Slice> slice) {
-        if (currentSlice.has_value() && currentSlice.value()) {
-            currentSlice.value()->End();
-        }
+    void SetCurrentSlice(SliceHandle slice) {
+        SliceStore::Instance().End(currentSlice);
         currentSlice = slice;
     }
 
     void ResetCurrentSlice() {
-        if (currentSlice.has_value() && currentSlice.value()) {
-            currentSlice.value()->End();
-        }
-        currentSlice.reset();
+        SliceStore::Instance().End(currentSlice);
+        currentSlice = {};
     }
 };
 
@@ -78,13 +71,11 @@ public:
 
     void UpdateStatus(const ThreadState &newState, uint64_t timestamp = GetTime()) {
         if (currentState != newState) {
-            EndCurrentSlice();
+            EndCurrentSlice(timestamp);
 
             if (newState.state != ThreadState::State::TASK_STOPPED) {
-                std::string sliceName = GetStateDisplayName(newState);
-                if (!newState.description.empty()) {
-                    sliceName = newState.description;
-                }
+                const std::string_view sliceName =
+                    newState.description.empty() ? GetStateDisplayName(newState) : newState.description;
                 currentSlice = statusTrack->StartSlice(sliceName, timestamp);
             }
 
@@ -99,16 +90,14 @@ public:
 private:
     std::shared_ptr<TrackNode> statusTrack;
     ThreadState currentState{ThreadState::State::TASK_STOPPED};
-    std::shared_ptr<Slice> currentSlice;
+    SliceHandle currentSlice;
 
-    void EndCurrentSlice() {
-        if (currentSlice) {
-            currentSlice->End();
-            currentSlice.reset();
-        }
+    void EndCurrentSlice(uint64_t timestamp) {
+        SliceStore::Instance().End(currentSlice, timestamp);
+        currentSlice = {};
     }
 
-    std::string GetStateDisplayName(const ThreadState &state) const {
+    std::string_view GetStateDisplayName(const ThreadState &state) const {
         switch (state.state) {
         case ThreadState::State::TASK_RUNNING:
             return "Running";
@@ -137,6 +126,8 @@ struct Thread {
     std::shared_ptr<TrackNode> lockTrack; // Single lock track for all locks
     std::shared_ptr<TrackNode> messageTrack;
     std::shared_ptr<TrackNode> extraInfoTrack;
+    std::shared_ptr<TrackNode> zoneTrack; /* Created with the first zone */
+    std::vector<SliceHandle> zoneStack;
 
     Thread() = default;
     Thread(int32_t pid, std::string name) : pid(pid), name(name) {
@@ -154,7 +145,8 @@ struct PerfettoApi {
     static uint32_t currentThreadId;
 
 public:
-    static std::unique_ptr<perfetto::TracingSession> StartTracing();
+    /** Starts a session that streams the trace into `outputFile` while tracing */
+    static std::unique_ptr<perfetto::TracingSession> StartTracing(const std::string &outputFile);
     static void StopTracing(std::unique_ptr<perfetto::TracingSession> tracing_session);
 
     static void RegisterThread(uint32_t threadId, std::string_view threadName, int32_t groupHint = 0);
@@ -168,11 +160,15 @@ public:
         uint32_t color = 0
     );
     static void ZoneEnd();
-    static void Plot(std::string_view name, int64_t value);
+    /** Sets a counter; with a `handle`, each task or kernel object gets a counter of its own */
+    static void Plot(std::string_view name, int64_t value, uint32_t handle = 0);
+    /** Moves the trace time on and writes the counter values that are final with that */
+    static void SetTime(uint64_t nanoseconds);
     static void PlotConfig(std::string_view name, int type, bool step, bool fill, uint32_t color);
+    /** Console lines are written inline, other text is interned and should come from a limited set */
     static void Message(std::string_view text, bool isConsole = 0);
-    static void Alloc(const void *ptr, size_t size, std::string_view name = {});
-    static void Free(const void *ptr, std::string_view name = {});
+    /** A debug event whose varying values are in `args`, so that the text is the same for every event of a kind */
+    static void Message(std::string_view text, std::initializer_list<DebugArg> args);
 
     static void SetupLockableIfNeeded(uint32_t id);
     static void LockableCreate(uint32_t id, std::string_view name, std::string_view type);
@@ -194,12 +190,22 @@ public:
     static void FlowBegin(uint32_t flow_id, std::string_view name = {});
     static void FlowEnd(uint32_t flow_id, std::string_view name = {});
 
+    /** Marks data lost on the way from the target on a global track */
+    static void DataLost(std::string_view description);
+
     static TrackManager &GetTrackManager() {
         return TrackManager::Instance();
     }
 
 private:
+    static constexpr uint32_t BUFFER_SIZE_KB = 32 * 1024;
+    static constexpr uint32_t FILE_WRITE_PERIOD_MS = 500;
+    static constexpr uint32_t FLUSH_PERIOD_MS = 250;
+
     static std::unique_ptr<SymbolResolver> symbolResolver;
+    static std::shared_ptr<TrackNode> dataLossTrack;
+    static int outputFd;
+    static std::string outputPath;
 
     static void CreateThread(uint32_t threadId, std::string_view threadName = {});
     static Thread *FindThread(uint32_t threadId);
@@ -1,37 +1,87 @@
 #pragma once
 
 #include <cstdint>
-#include <perfetto.h>
-#include <string>
+#include <limits>
+#include <string_view>
+#include <vector>
 
 #include "Packet.hpp"
 #include "TimeUtils.hpp"
 
 namespace profiler {
 
-struct Slice {
-    uint64_t trackId;
-    uint64_t startTime;
-    std::string name;
-    bool active = true;
+/** Refers to a slice in the SliceStore. A handle to a slice that has ended is stale, and ending it does nothing. */
+struct SliceHandle {
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
 
-    Slice(const uint64_t trackId, uint64_t startTime, const std::string &name)
-        : trackId(trackId), startTime(startTime), name(name) {
-        CreateTrackEvent(trackId, startTime, perfetto::protos::pbzero::TrackEvent::TYPE_SLICE_BEGIN, name);
+    uint32_t index = NONE;
+    uint32_t generation = 0;
+
+    explicit operator bool() const {
+        return index != NONE;
+    }
+};
+
+/**
+ * Open slices, kept in a pool that is indexed by SliceHandle. Ended slots are reused, so starting and ending a slice
+ * neither allocates nor touches the other slices. Only what the end event needs is kept, the name is written with the
+ * begin event.
+ */
+class SliceStore {
+public:
+    static SliceStore &Instance() {
+        static SliceStore instance;
+        return instance;
     }
 
-    ~Slice() {
-        if (active) {
-            End();
+    SliceHandle Begin(uint64_t trackId, std::string_view name, uint64_t timestamp = GetTime()) {
+        uint32_t index;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back();
         }
+
+        auto &slot = slots_[index];
+        slot.trackId = trackId;
+        slot.active = true;
+        CreateTrackEvent(trackId, timestamp, perfetto::protos::pbzero::TrackEvent::TYPE_SLICE_BEGIN, name);
+        return {index, slot.generation};
     }
 
-    void End(uint64_t timestamp = GetTime()) {
-        if (active) {
-            CreateTrackEvent(trackId, timestamp, perfetto::protos::pbzero::TrackEvent::TYPE_SLICE_END);
-            active = false;
+    void End(SliceHandle handle, uint64_t timestamp = GetTime()) {
+        if (!IsActive(handle)) {
+            return;
         }
+        auto &slot = slots_[handle.index];
+        CreateTrackEvent(slot.trackId, timestamp, perfetto::protos::pbzero::TrackEvent::TYPE_SLICE_END);
+        slot.active = false;
+        ++slot.generation;
+        free_.push_back(handle.index);
+    }
+
+    bool IsActive(SliceHandle handle) const {
+        return handle.index < slots_.size() && slots_[handle.index].active &&
+               slots_[handle.index].generation == handle.generation;
+    }
+
+    size_t ActiveCount() const {
+        return slots_.size() - free_.size();
     }
+
+private:
+    struct Slot {
+        uint64_t trackId = 0;
+        uint32_t generation = 0;
+        bool active = false;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_;
+
+    SliceStore() = default;
 };
 
-}
\ No newline at end of file
+}
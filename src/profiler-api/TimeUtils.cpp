@@ -5,6 +5,7 @@
 namespace profiler {
 
 static uint64_t time_ns = 0;
+static TraceClock traceClock;
 
 void SetTime(uint64_t nanoseconds) {
     time_ns = nanoseconds;
@@ -18,4 +19,16 @@ uint64_t GetTime() {
     return initTimestamp + time_ns;
 }
 
+void SetClockFrequency(uint64_t hz) {
+    const uint64_t unitNs = hz != 0 && 1000000000 % hz == 0 ? 1000000000 / hz : 1;
+    if (unitNs != traceClock.unitNs) {
+        traceClock.unitNs = unitNs;
+        ++traceClock.generation;
+    }
+}
+
+const TraceClock &GetTraceClock() {
+    return traceClock;
+}
+
 }
\ No newline at end of file
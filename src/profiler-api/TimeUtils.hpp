@@ -7,4 +7,17 @@ namespace profiler {
 void SetTime(uint64_t nanoseconds);
 uint64_t GetTime();
 
+/**
+ * The clock that trace packets are timestamped in. Perfetto only takes a whole number of nanoseconds per unit, so
+ * this is the target's CPU cycle when the core frequency divides 1 GHz, and a nanosecond otherwise.
+ */
+struct TraceClock {
+    uint64_t unitNs = 1;
+    /* Changes with the unit, so that writers know to declare the clock again */
+    uint32_t generation = 0;
+};
+
+void SetClockFrequency(uint64_t hz);
+const TraceClock &GetTraceClock();
+
 }
\ No newline at end of file
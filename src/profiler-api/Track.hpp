@@ -1,12 +1,12 @@
 #pragma once
 
-#include <algorithm>
 #include <atomic>
 #include <cstdint>
-#include <iostream>
 #include <memory>
 #include <perfetto.h>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -34,7 +34,6 @@ struct TrackNode : std::enable_shared_from_this<TrackNode> {
     std::string name;
     std::weak_ptr<TrackNode> parent;
     std::vector<std::shared_ptr<TrackNode>> children;
-    std::vector<std::shared_ptr<Slice>> activeSlices;
 
     uint64_t id = GenerateUniqueUuid();
 
@@ -50,43 +49,29 @@ struct TrackNode : std::enable_shared_from_this<TrackNode> {
         child->parent = shared_from_this();
     }
 
-    std::shared_ptr<Slice> StartSlice(const std::string &name, uint64_t timestamp = GetTime()) {
-        auto slice = std::make_shared<Slice>(id, timestamp, name);
-        activeSlices.push_back(slice);
-        RemoveInactiveSlices();
+    SliceHandle StartSlice(std::string_view name, uint64_t timestamp = GetTime()) {
+        return SliceStore::Instance().Begin(id, name, timestamp);
+    }
 
-        return slice;
+    void Message(std::string_view name, std::span<const DebugArg> args = {}, uint64_t timestamp = GetTime()) {
+        CreateTrackEvent(id, timestamp, perfetto::protos::pbzero::TrackEvent::TYPE_INSTANT, name, args);
     }
 
-    void Message(std::string_view name, uint64_t timestamp = GetTime()) {
-        CreateTrackEvent(id, timestamp, perfetto::protos::pbzero::TrackEvent::TYPE_INSTANT, name);
+    /** An instant event with text that is unlikely to repeat, written inline rather than interned */
+    void Text(std::string_view text, uint64_t timestamp = GetTime()) {
+        CreateTrackEvent(id, timestamp, perfetto::protos::pbzero::TrackEvent::TYPE_INSTANT, text, {}, false);
     }
 
 private:
     void SetupTrackDescriptor() {
-        auto packet = CreatePacket();
-        auto *trackDesc = packet->set_track_descriptor();
-        trackDesc->set_uuid(id);
-        trackDesc->set_name(name);
-
-        std::cout << ">> TRACK CREATED, ID " << id;
-        if (auto parentNode = parent.lock()) {
-            trackDesc->set_parent_uuid(parentNode->id);
-            std::cout << " PARENT  " << parentNode->id;
-        }
-        std::cout << std::endl;
-    }
-
-    void RemoveInactiveSlices() {
-        activeSlices.erase(
-            std::remove_if(
-                activeSlices.begin(), activeSlices.end(),
-                [](const std::shared_ptr<Slice> &slice) {
-                    return !slice || !slice->active;
-                }
-            ),
-            activeSlices.end()
-        );
+        EmitPacket(GetTime(), [this](auto &packet, SequenceState &) {
+            auto *trackDesc = packet->set_track_descriptor();
+            trackDesc->set_uuid(id);
+            trackDesc->set_name(name);
+            if (auto parentNode = parent.lock()) {
+                trackDesc->set_parent_uuid(parentNode->id);
+            }
+        });
     }
 };
 
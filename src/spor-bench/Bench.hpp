@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string_view>
+
+namespace bench {
+
+/** Keeps results alive so the measured work is not optimised away */
+inline volatile uint64_t sink;
+
+/**
+ * Runs `fn` `repeats` times and prints the best run as time per item, items per second and input throughput.
+ * Returns the best time in nanoseconds per item.
+ */
+template <typename Fn>
+double Measure(std::string_view name, size_t items, size_t bytes, Fn &&fn, int repeats = 5) {
+    using Clock = std::chrono::steady_clock;
+
+    double best = 0;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = Clock::now();
+        fn();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        best = i == 0 ? seconds : std::min(best, seconds);
+    }
+
+    double nsPerItem = best * 1e9 / static_cast<double>(items);
+    std::printf(
+        "%-52.*s %9.2f ns/item %9.2f M items/s %9.1f MB/s\n", static_cast<int>(name.size()), name.data(), nsPerItem,
+        static_cast<double>(items) / best / 1e6, static_cast<double>(bytes) / best / 1e6
+    );
+    return nsPerItem;
+}
+
+/** Returns false when the block decoder does not pass on the same packets as ITMDecoder */
+bool RunOrbcatBenchmarks();
+
+/** Returns false when decoding still allocates once warmed up, or function events do not decode as they were sent */
+bool RunDecoderBenchmarks();
+
+/** Returns false when the host gets the time of cycle counts wrong */
+bool RunHostBenchmarks();
+
+}
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "orbcat/StaticOrbcat.hpp"
+#include "spor-host/Pipeline.hpp"
+#include "SwoGenerator.hpp"
+#include "zpp_bits.h"
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+}
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace bench {
+
+namespace {
+
+/** One ITM software packet as the message decoder receives it */
+struct DecoderPacket {
+    Channel channel;
+    uint8_t size;
+    std::array<std::byte, 4> data;
+};
+
+class PacketWriter {
+public:
+    std::vector<DecoderPacket> packets;
+
+    /** Sends a message the way spor::Send does: cycle count, framed type and length, then the payload */
+    template <typename T>
+    void Message(const T &message, uint32_t cycles) {
+        std::array<std::byte, 100> buffer;
+        zpp::bits::out out(buffer, zpp::bits::size_varint{});
+        out(message).or_throw();
+
+        Write(Channel::CYCLE_COUNT, std::as_bytes(std::span(&cycles, 1)));
+        const std::array header{
+            static_cast<std::byte>(::Message(message).index()), static_cast<std::byte>(out.position())
+        };
+        Write(Channel::MESSAGE_TYPE, header);
+        Write(Channel::MESSAGE_DATA, std::span(buffer).first(out.position()));
+    }
+
+    void Write(Channel channel, std::span<const std::byte> data) {
+        while (!data.empty()) {
+            const size_t size = data.size() >= 4 ? 4 : data.size() >= 2 ? 2 : 1;
+            DecoderPacket packet{channel, static_cast<uint8_t>(size), {}};
+            std::copy_n(data.begin(), size, packet.data.begin());
+            packets.push_back(packet);
+            data = data.subspan(size);
+        }
+    }
+};
+
+std::vector<DecoderPacket> GenerateMessages(size_t events) {
+    static const std::array<std::string, 4> names{"idle", "network", "display_refresh", "a_longer_zone_name"};
+
+    PacketWriter writer;
+    for (size_t i = 0; i < events; ++i) {
+        const auto cycles = static_cast<uint32_t>(i * 1000);
+        const auto handle = 0x20000000 | static_cast<uint32_t>(i % 8 * 0x100);
+
+        switch (i % 6) {
+        case 0:
+            writer.Message(FreertosTaskSwitchedInMessage{handle}, cycles);
+            break;
+        case 1:
+            writer.Message(ZoneBeginData{handle}, cycles);
+            break;
+        case 2:
+            writer.Message(ZoneTextMessage{names[i % names.size()]}, cycles);
+            break;
+        case 3:
+            writer.Message(PlotMessage{{static_cast<int64_t>(i)}, names[i % names.size()]}, cycles);
+            break;
+        case 4:
+            writer.Message(ZoneEndData{handle}, cycles);
+            break;
+        case 5:
+            writer.Write(Channel::CONSOLE_LOG, std::as_bytes(std::span("log line\n").first(9)));
+            break;
+        }
+    }
+    return writer.packets;
+}
+
+/** Message decoder handler that keeps the function events, with the cycle count that came before each */
+struct FunctionCollector {
+    std::vector<TrafficGenerator::FunctionCall> calls;
+    uint32_t cycles = 0;
+
+    template <typename T>
+    void OnMessage(const T &message) {
+        if constexpr (std::is_same_v<T, FunctionTraceEnterData> || std::is_same_v<T, FunctionTraceExitData>) {
+            calls.push_back({message.fn, std::is_same_v<T, FunctionTraceExitData>, cycles});
+        }
+    }
+
+    void OnCycleCount(uint32_t cycleCount) {
+        cycles = cycleCount;
+    }
+
+    void OnConsoleLog(const void *, size_t) {}
+};
+
+struct FunctionSink {
+    BasicMessageDecoder<FunctionCollector> &decoder;
+
+    void OnChannelData(uint8_t channel, uint64_t timestamp, std::span<const std::byte> data) {
+        decoder.ProcessChannelData(channel, timestamp, data);
+    }
+};
+
+/**
+ * Encodes random calls and returns the way the target's function instrumentation does, with and without compact
+ * records, and checks that the host decodes every address, direction and cycle count as it was sent.
+ */
+bool CheckFunctionEvents(size_t count) {
+    bool ok = true;
+    for (bool records : {false, true}) {
+        /* No random messages, since FunctionTraceEnterData and FunctionTraceExitData are among them */
+        TrafficGenerator generator(
+            {.messages = 0, .functions = 30, .cycleCounts = 1, .console = 1, .records = records}
+        );
+        generator.Generate(count);
+
+        FunctionCollector collector;
+        BasicMessageDecoder<FunctionCollector> decoder(collector);
+        FunctionSink functionSink{decoder};
+        orbcat::ItmDemux<FunctionSink>(functionSink).Feed(generator.writer.bytes);
+
+        const auto mismatch = std::ranges::mismatch(generator.calls, collector.calls);
+        const bool same = mismatch.in1 == generator.calls.end() && mismatch.in2 == collector.calls.end();
+        std::printf(
+            "Function events%s (%zu calls and returns): %s\n", records ? ", compact" : "", generator.calls.size(),
+            same ? "decoded exactly" : "MISMATCH"
+        );
+        if (!same) {
+            std::printf(
+                "MISMATCH: first difference at event %zu, %zu events decoded\n",
+                static_cast<size_t>(mismatch.in1 - generator.calls.begin()), collector.calls.size()
+            );
+        }
+        ok &= same;
+    }
+    return ok;
+}
+
+void Decode(EventDecoder &decoder, std::span<const DecoderPacket> packets) {
+    for (const auto &packet : packets) {
+        decoder.ProcessChannelData(static_cast<uint8_t>(packet.channel), 0, std::span(packet.data).first(packet.size));
+    }
+}
+
+}
+
+bool RunDecoderBenchmarks() {
+    constexpr size_t EVENTS = 1 << 18;
+    constexpr size_t BATCH = 4096;
+
+    const auto packets = GenerateMessages(EVENTS);
+    std::printf("\nMessage decoding (%zu events, %zu packets)\n", EVENTS, packets.size());
+
+    EventCollector collector;
+    EventDecoder decoder(collector);
+
+    /* Batches the way the pipeline's decode stage does, so the collector's storage is reused */
+    auto decodeAll = [&] {
+        for (size_t offset = 0; offset < packets.size(); offset += BATCH) {
+            Decode(decoder, std::span(packets).subspan(offset, std::min(BATCH, packets.size() - offset)));
+            sink = collector.events.size();
+            collector.Clear();
+        }
+    };
+
+    /* The first pass grows the event vector, the string arena and the decoder buffers */
+    decodeAll();
+
+    const size_t before = allocations.load(std::memory_order_relaxed);
+    Measure("BasicMessageDecoder into EventCollector", EVENTS, packets.size() * sizeof(uint32_t), decodeAll);
+    const size_t steadyAllocations = allocations.load(std::memory_order_relaxed) - before;
+
+    std::printf("Heap allocations after warm-up: %zu\n", steadyAllocations);
+
+    const bool functionsDecoded = CheckFunctionEvents(1 << 16);
+    return steadyAllocations == 0 && functionsDecoded;
+}
+
+}
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Counter.hpp"
+#include "orbcat/StaticOrbcat.hpp"
+#include "PerfettoApi.hpp"
+#include "spor-host/HeapTracker.hpp"
+#include "spor-host/Pipeline.hpp"
+#include "spor-host/SporHost.hpp"
+#include "SwoGenerator.hpp"
+
+namespace bench {
+
+namespace {
+
+/** Feeds channel data to a message decoder, like spor-host's single-threaded path */
+template <typename Decoder>
+struct DecoderSink {
+    Decoder &decoder;
+
+    void OnChannelData(uint8_t channel, uint64_t timestamp, std::span<const std::byte> data) {
+        decoder.ProcessChannelData(channel, timestamp, data);
+    }
+};
+
+/** Same as DecoderSink, but keeps the events for the emission stage */
+struct CollectingSink {
+    EventDecoder &decoder;
+    EventCollector &collector;
+
+    void OnChannelData(uint8_t channel, uint64_t timestamp, std::span<const std::byte> data) {
+        decoder.ProcessChannelData(channel, timestamp, data);
+    }
+
+    void OnException(const orbcat::ExceptionMessage &exception, uint64_t timestamp) {
+        collector.events.emplace_back(ExceptionEvent{exception, timestamp});
+    }
+};
+
+struct Traffic {
+    std::string_view name;
+    TrafficMix mix;
+};
+
+void RunTraffic(const Traffic &traffic, size_t count) {
+    TrafficGenerator generator(traffic.mix);
+    generator.Generate(count);
+    const auto &swo = generator.writer.bytes;
+    const size_t events = generator.events;
+
+    std::printf(
+        "\n%.*s traffic (%zu events, %zu bytes, %.1f bytes/event)\n", static_cast<int>(traffic.name.size()),
+        traffic.name.data(), events, swo.size(), static_cast<double>(swo.size()) / static_cast<double>(events)
+    );
+
+    /* ITM decoding and message decoding, without handling the messages */
+    {
+        EventCollector collector;
+        EventDecoder decoder(collector);
+        DecoderSink<EventDecoder> decoderSink{decoder};
+        orbcat::ItmDemux<DecoderSink<EventDecoder>> demux(decoderSink);
+        Measure("ItmDemux + MessageDecoder", events, swo.size(), [&] {
+            for (size_t offset = 0; offset < swo.size(); offset += 64 << 10) {
+                demux.Feed(std::span(swo).subspan(offset, std::min<size_t>(64 << 10, swo.size() - offset)));
+                sink = collector.events.size();
+                collector.Clear();
+            }
+        });
+    }
+
+    /* SporHost handlers and Perfetto emission on already decoded events, the pipeline's emission stage */
+    EventCollector collector;
+    EventDecoder decoder(collector);
+    CollectingSink collectingSink{decoder, collector};
+    orbcat::ItmDemux<CollectingSink> demux(collectingSink);
+    demux.Feed(swo);
+
+    auto &host = SporHost::GetInstance();
+    Measure("SporHost + Perfetto emission (emission stage)", collector.events.size(), swo.size(), [&] {
+        for (const auto &event : collector.events) {
+            ApplyEvent(host, event);
+        }
+    });
+
+    /* Everything spor-host does on one thread for a capture */
+    MessageDecoder hostDecoder(host);
+    DecoderSink<MessageDecoder> hostSink{hostDecoder};
+    orbcat::ItmDemux<DecoderSink<MessageDecoder>> hostDemux(hostSink);
+    Measure("ItmDemux + MessageDecoder + SporHost + Perfetto", events, swo.size(), [&] {
+        hostDemux.Feed(swo);
+    });
+}
+
+/** Starting and ending a slice on one track, which every task switch, lock and zone does */
+void RunSliceEmission(size_t count) {
+    auto track = profiler::TrackManager::Instance().CreateTrack(profiler::TrackType::CUSTOM, "Bench slices");
+    auto &store = profiler::SliceStore::Instance();
+    uint64_t time = profiler::GetTime();
+    std::printf("\n");
+    Measure("Slice begin + end (Perfetto emission)", count, 0, [&] {
+        for (size_t i = 0; i < count; ++i) {
+            store.End(track->StartSlice("slice", time), time + 5);
+            time += 10;
+        }
+    });
+}
+
+/** A queue whose depth goes up and down every 20 us, with a send and a receive in every other tick */
+void RunCounterUpdates(size_t count) {
+    auto &store = profiler::CounterStore::Instance();
+    uint64_t time = profiler::GetTime();
+    Measure("Queue depth counter updates", count, 0, [&] {
+        for (size_t i = 0; i < count; ++i) {
+            store.Update("Queue Depth", 0x20001000, static_cast<int64_t>(i % 8), time, "Bench queue depth");
+            time += (i % 2) * 20000;
+            store.FlushBefore(time);
+        }
+        store.Flush();
+    });
+}
+
+/**
+ * Feeds cycle counts across an idle gap of more than 2^31 cycles, which must advance time, and with the deferred
+ * transport a count older than the last one, which must not.
+ */
+bool CheckCycleCounts() {
+    constexpr uint32_t GAP = 0x90000000;
+    bool ok = true;
+    auto check = [&](std::string_view name, uint64_t cycles, uint64_t expected) {
+        if (cycles != expected) {
+            std::printf(
+                "MISMATCH: %.*s: %llu cycles instead of %llu\n", static_cast<int>(name.size()), name.data(),
+                static_cast<unsigned long long>(cycles), static_cast<unsigned long long>(expected)
+            );
+            ok = false;
+        }
+    };
+
+    SporHost idle;
+    idle.OnCycleCount(0xF0000000);
+    idle.OnCycleCount(0xF0000000 + GAP);
+    idle.OnCycleCount(0xF0000000 + GAP + 1000);
+    check("idle gap", idle.cycles, uint64_t{GAP} + 1000);
+
+    SporHost deferred;
+    deferred.deferredTransport = true;
+    deferred.OnCycleCount(0xF0000000);
+    deferred.OnCycleCount(0xF0000000 + 5000);
+    deferred.OnCycleCount(0xF0000000 + 4000);
+    deferred.OnCycleCount(0xF0000000 + 6000);
+    check("deferred transport, step back", deferred.cycles, 6000);
+    profiler::SetTime(0);
+
+    std::printf("\nCycle counts across an idle gap of %u cycles: %s\n", GAP, ok ? "correct" : "MISMATCH");
+    return ok;
+}
+
+/** Allocations and frees with 4096 blocks live, as FreeRTOS heap traffic would produce them */
+void RunHeapChurn(size_t count) {
+    constexpr size_t LIVE_BLOCKS = 4096;
+    /* Scattered over 8 MB, as a fragmented heap hands them out */
+    auto address = [](size_t i) {
+        return static_cast<TargetPointer>(0x20000000 + (i * 2654435761u % (1 << 20)) * 8);
+    };
+    HeapTracker heap;
+    Measure("Heap alloc + free", count, 0, [&] {
+        for (size_t i = 0; i < count; ++i) {
+            heap.Alloc(address(i), static_cast<uint32_t>(32 + i % 64), 0, i % 4 ? "" : "message");
+            if (i >= LIVE_BLOCKS) {
+                heap.Free(address(i - LIVE_BLOCKS));
+            }
+        }
+    });
+}
+
+}
+
+bool RunHostBenchmarks() {
+    const bool cycleCountsCorrect = CheckCycleCounts();
+
+    const auto tracePath = std::filesystem::temp_directory_path() / "spor-bench.pftrace";
+    auto session = profiler::PerfettoApi::StartTracing(tracePath.string());
+
+    static const Traffic mixes[] = {
+        {"Mixed", {}},
+        {"Message-heavy", {.messages = 1, .functions = 0, .cycleCounts = 0, .console = 0}},
+        {"Message-heavy, compact records",
+         {.messages = 1, .functions = 0, .cycleCounts = 0, .console = 0, .records = true}},
+        {"Function trace", {.messages = 1, .functions = 30, .cycleCounts = 1, .console = 0}},
+        {"Function trace, compact",
+         {.messages = 1, .functions = 30, .cycleCounts = 1, .console = 0, .records = true}},
+        {"Console-heavy", {.messages = 1, .functions = 0, .cycleCounts = 0, .console = 4}},
+    };
+    for (const auto &traffic : mixes) {
+        RunTraffic(traffic, 1 << 18);
+    }
+    RunSliceEmission(1 << 20);
+    RunCounterUpdates(1 << 20);
+    RunHeapChurn(1 << 21);
+
+    profiler::PerfettoApi::StopTracing(std::move(session));
+    std::filesystem::remove(tracePath);
+    return cycleCountsCorrect;
+}
+
+}
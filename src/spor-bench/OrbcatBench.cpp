@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "Bench.hpp"
+#include "orbcat/StaticOrbcat.hpp"
+#include "SwoGenerator.hpp"
+
+namespace bench {
+
+namespace {
+
+/** Roughly what spor-host sees: a cycle count, a message type and message data per event */
+std::vector<uint8_t> GenerateTraffic(size_t events, size_t &packets) {
+    SwoWriter writer;
+    writer.Sync();
+    packets = 0;
+
+    for (size_t i = 0; i < events; ++i) {
+        writer.Software(Channel::CYCLE_COUNT, static_cast<uint32_t>(i * 1000));
+        writer.Software(Channel::MESSAGE_TYPE, i % 66, 1);
+        writer.Software(Channel::MESSAGE_DATA, 0x20000000 | static_cast<uint32_t>(i));
+        writer.Software(Channel::MESSAGE_DATA, static_cast<uint32_t>(i), 2);
+        packets += 4;
+
+        if (i % 16 == 0) {
+            writer.LocalTimestamp(static_cast<uint32_t>(i % 200));
+            packets++;
+        }
+        if (i % 64 == 0) {
+            writer.Exception(16 + i % 80, 1 + i % 2);
+            packets++;
+        }
+    }
+    return writer.bytes;
+}
+
+/**
+ * Software and hardware traffic mixed with the packets the host skips or only counts: overflows, global timestamps,
+ * extension packets and synchronisation packets in the middle of the stream.
+ */
+std::vector<uint8_t> GenerateMixedTraffic(size_t events) {
+    SwoWriter writer;
+    writer.Sync();
+
+    for (size_t i = 0; i < events; ++i) {
+        const auto value = static_cast<uint32_t>(i * 2654435761u);
+        writer.Software(Channel::CYCLE_COUNT, value);
+        writer.Software(static_cast<Channel>(i % 32), value >> 8, static_cast<uint8_t>(1 << (i % 3)));
+
+        switch (i % 11) {
+        case 0:
+            writer.Overflow();
+            break;
+        case 1:
+            writer.GlobalTimestamp(uint64_t{value} << 12 | i);
+            break;
+        case 2:
+            writer.PageExtension();
+            break;
+        case 3:
+            writer.HardwareExtension(static_cast<uint8_t>(i), value >> (i % 32));
+            break;
+        case 4:
+            writer.PcSample(0x08000000 | (value & 0xFFFFE), i % 7 == 0);
+            break;
+        case 5:
+            writer.LocalTimestamp(value % 300);
+            break;
+        case 6:
+            writer.Exception(static_cast<uint16_t>(16 + value % 80), static_cast<uint8_t>(1 + i % 3));
+            break;
+        case 7:
+            if (i % 97 == 7) {
+                writer.Sync();
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return writer.bytes;
+}
+
+struct CountingSink {
+    uint64_t total = 0;
+
+    void OnChannelData(uint8_t channel, uint64_t timestamp, std::span<const std::byte> data) {
+        total += channel + data.size() + static_cast<uint8_t>(data[0]);
+    }
+
+    void OnTimestamp(uint64_t timestamp, orbcat::TimeStatus status) {
+        total += timestamp;
+    }
+
+    void OnException(const orbcat::ExceptionMessage &exception, uint64_t timestamp) {
+        total += exception.exceptionNumber;
+    }
+};
+
+/** Keeps every packet in the order it arrived, to compare the decoders */
+struct RecordingSink {
+    struct Packet {
+        enum class Kind : uint8_t { CHANNEL, TIMESTAMP, EXCEPTION, PC_SAMPLE, OVERFLOW } kind;
+        uint8_t channel;
+        uint8_t size;
+        uint32_t value;
+        uint64_t timestamp;
+
+        bool operator==(const Packet &) const = default;
+    };
+
+    std::vector<Packet> packets;
+
+    void OnChannelData(uint8_t channel, uint64_t timestamp, std::span<const std::byte> data) {
+        uint32_t value = 0;
+        std::memcpy(&value, data.data(), std::min(data.size(), sizeof(value)));
+        packets.push_back({Packet::Kind::CHANNEL, channel, static_cast<uint8_t>(data.size()), value, timestamp});
+    }
+
+    void OnTimestamp(uint64_t timestamp, orbcat::TimeStatus status) {
+        packets.push_back({Packet::Kind::TIMESTAMP, 0, static_cast<uint8_t>(status), 0, timestamp});
+    }
+
+    void OnException(const orbcat::ExceptionMessage &exception, uint64_t timestamp) {
+        packets.push_back(
+            {Packet::Kind::EXCEPTION, 0, static_cast<uint8_t>(exception.event), exception.exceptionNumber, timestamp}
+        );
+    }
+
+    void OnPcSample(const orbcat::PcSample &sample, uint64_t timestamp) {
+        packets.push_back({Packet::Kind::PC_SAMPLE, 0, sample.sleeping, sample.pc, timestamp});
+    }
+
+    void OnOverflow(uint64_t timestamp) {
+        packets.push_back({Packet::Kind::OVERFLOW, 0, 0, 0, timestamp});
+    }
+};
+
+template <typename Sink>
+orbcat::MessageHandler MakeHandlers(Sink &sink) {
+    orbcat::MessageHandler handlers;
+    handlers.onChannelData = [&sink](uint8_t channel, uint64_t timestamp, std::span<std::byte> data) {
+        sink.OnChannelData(channel, timestamp, data);
+    };
+    handlers.onTimestamp = [&sink](uint64_t timestamp, orbcat::TimeStatus status) {
+        sink.OnTimestamp(timestamp, status);
+    };
+    handlers.onException = [&sink](const orbcat::ExceptionMessage &exception, uint64_t timestamp) {
+        sink.OnException(exception, timestamp);
+    };
+    if constexpr (requires { sink.OnOverflow(uint64_t{}); }) {
+        handlers.onPcSample = [&sink](const orbcat::PcSample &sample, uint64_t timestamp) {
+            sink.OnPcSample(sample, timestamp);
+        };
+        handlers.onOverflow = [&sink](uint64_t timestamp) {
+            sink.OnOverflow(timestamp);
+        };
+    }
+    return handlers;
+}
+
+bool SamePackets(std::string_view name, const RecordingSink &expected, const RecordingSink &actual) {
+    const auto mismatch = std::ranges::mismatch(expected.packets, actual.packets);
+    if (mismatch.in1 == expected.packets.end() && mismatch.in2 == actual.packets.end()) {
+        return true;
+    }
+    std::printf(
+        "MISMATCH: %.*s differs from ITMDecoder at packet %zu (%zu vs %zu packets)\n", static_cast<int>(name.size()),
+        name.data(), static_cast<size_t>(mismatch.in1 - expected.packets.begin()), expected.packets.size(),
+        actual.packets.size()
+    );
+    return false;
+}
+
+/**
+ * Checks that the block decoder passes on exactly the packets of the ITMDecoder path, also when the data arrives in
+ * buffers of odd sizes that split packets and synchronisation sequences. `swo` should contain every kind of packet
+ * the block decoder skips as well as those it decodes.
+ */
+bool CheckEquivalence(std::span<const uint8_t> swo) {
+    RecordingSink expected;
+    orbcat::Orbcat::Options legacyOptions;
+    legacyOptions.useBlockDecoder = false;
+    orbcat::Orbcat(legacyOptions, MakeHandlers(expected)).Feed(swo);
+
+    RecordingSink dynamic;
+    orbcat::Orbcat(orbcat::Orbcat::Options{}, MakeHandlers(dynamic)).Feed(swo);
+    bool same = SamePackets("ItmBlockDecoder, std::function handlers", expected, dynamic);
+
+    RecordingSink whole;
+    orbcat::ItmDemux<RecordingSink>(whole).Feed(swo);
+    same &= SamePackets("ItmDemux", expected, whole);
+
+    constexpr size_t SPLITS[] = {1, 2, 3, 5, 7, 13, 61, 509, 4093};
+    RecordingSink split;
+    orbcat::ItmDemux<RecordingSink> splitDemux(split);
+    for (size_t offset = 0, i = 0; offset < swo.size(); ++i) {
+        const size_t size = std::min(SPLITS[i % std::size(SPLITS)], swo.size() - offset);
+        splitDemux.Feed(swo.subspan(offset, size));
+        offset += size;
+    }
+    same &= SamePackets("ItmDemux, split feed", expected, split);
+
+    std::printf(
+        "Decoder equivalence (%zu packets): %s\n", expected.packets.size(), same ? "identical" : "MISMATCH"
+    );
+    return same;
+}
+
+}
+
+bool RunOrbcatBenchmarks() {
+    size_t packets = 0;
+    const auto swo = GenerateTraffic(1 << 20, packets);
+    std::printf("\nITM decoding and dispatch (%zu packets, %zu bytes)\n", packets, swo.size());
+    const bool equivalent = CheckEquivalence(GenerateMixedTraffic(1 << 18));
+
+    CountingSink legacyCounter;
+    orbcat::Orbcat::Options legacyOptions;
+    legacyOptions.useBlockDecoder = false;
+    orbcat::Orbcat legacy(legacyOptions, MakeHandlers(legacyCounter));
+    Measure("ITMDecoder, std::function handlers", packets, swo.size(), [&] {
+        legacy.Feed(swo);
+        sink = legacyCounter.total;
+    });
+
+    CountingSink dynamicCounter;
+    orbcat::Orbcat dynamic(orbcat::Orbcat::Options{}, MakeHandlers(dynamicCounter));
+    double dynamicNs = Measure("ItmBlockDecoder, std::function handlers", packets, swo.size(), [&] {
+        dynamic.Feed(swo);
+        sink = dynamicCounter.total;
+    });
+
+    CountingSink staticCounter;
+    orbcat::ItmDemux<CountingSink> demux(staticCounter);
+    double staticNs = Measure("ItmBlockDecoder, static sink (ItmDemux)", packets, swo.size(), [&] {
+        demux.Feed(swo);
+        sink = staticCounter.total;
+    });
+
+    std::printf("Per-packet overhead removed by the static sink: %.2f ns\n", dynamicNs - staticNs);
+    return equivalent;
+}
+
+}
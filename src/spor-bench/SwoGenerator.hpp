@@ -0,0 +1,361 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "spor-common/Channels.hpp"
+#include "spor-common/Messages.hpp"
+#include "spor-common/Record.hpp"
+#include "zpp_bits.h"
+
+namespace bench {
+
+/** Builds a synthetic ITM byte stream, as the target would emit it over SWO */
+class SwoWriter {
+public:
+    std::vector<uint8_t> bytes;
+
+    void Sync() {
+        bytes.insert(bytes.end(), {0x00, 0x00, 0x00, 0x00, 0x00, 0x80});
+    }
+
+    /** One software packet of 1, 2 or 4 bytes */
+    void Software(Channel channel, uint32_t value, uint8_t size = 4) {
+        static constexpr uint8_t sizeCodes[] = {0, 1, 2, 0, 3};
+        bytes.push_back(static_cast<uint8_t>((static_cast<uint8_t>(channel) << 3) | sizeCodes[size]));
+        for (uint8_t i = 0; i < size; ++i) {
+            bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    /** Splits `data` into software packets the way ITMWriteBuffer does */
+    void Software(Channel channel, std::span<const std::byte> data) {
+        while (!data.empty()) {
+            uint8_t size = data.size() >= 4 ? 4 : data.size() >= 2 ? 2 : 1;
+            uint32_t value = 0;
+            for (uint8_t i = 0; i < size; ++i) {
+                value |= static_cast<uint32_t>(data[i]) << (8 * i);
+            }
+            Software(channel, value, size);
+            data = data.subspan(size);
+        }
+    }
+
+    /** Local timestamp, using the single-byte form when the delta fits */
+    void LocalTimestamp(uint32_t delta) {
+        if (delta > 0 && delta < 7) {
+            bytes.push_back(static_cast<uint8_t>(delta << 4));
+            return;
+        }
+        bytes.push_back(0xC0);
+        do {
+            uint8_t byte = delta & 0x7F;
+            delta >>= 7;
+            bytes.push_back(delta ? byte | 0x80 : byte);
+        } while (delta);
+    }
+
+    void Exception(uint16_t number, uint8_t event) {
+        bytes.push_back(0x0E);
+        bytes.push_back(static_cast<uint8_t>(number));
+        bytes.push_back(static_cast<uint8_t>(((number >> 8) & 1) | (event << 4)));
+    }
+
+    /** Periodic PC sample, or the one-byte sleep marker */
+    void PcSample(uint32_t pc, bool sleeping = false) {
+        if (sleeping) {
+            bytes.insert(bytes.end(), {0x15, 0x00});
+            return;
+        }
+        bytes.push_back(0x17);
+        for (int i = 0; i < 4; ++i) {
+            bytes.push_back(static_cast<uint8_t>(pc >> (8 * i)));
+        }
+    }
+
+    void Overflow() {
+        bytes.push_back(0x70);
+    }
+
+    /** Global timestamp of 48 bits, as a GTS1 packet with the low 26 bits and a GTS2 packet with the rest */
+    void GlobalTimestamp(uint64_t value) {
+        for (auto [header, bits] : {std::pair{0x94, value & 0x3FFFFFF}, std::pair{0xB4, (value >> 26) & 0x3FFFFF}}) {
+            bytes.push_back(static_cast<uint8_t>(header));
+            for (int i = 0; i < 4; ++i) {
+                const auto byte = static_cast<uint8_t>(bits & 0x7F);
+                bits >>= 7;
+                bytes.push_back(i < 3 ? byte | 0x80 : byte);
+            }
+        }
+    }
+
+    /** Stimulus port page extension packet, only page 0 since spor uses the first 32 ports */
+    void PageExtension() {
+        bytes.push_back(0x08);
+    }
+
+    /** Extension packet of a hardware source with a continued payload, which the host has no use for */
+    void HardwareExtension(uint8_t ex, uint32_t payload) {
+        bytes.push_back(static_cast<uint8_t>(0x8C | (ex & 0x07) << 4));
+        do {
+            const auto byte = static_cast<uint8_t>(payload & 0x7F);
+            payload >>= 7;
+            bytes.push_back(payload ? byte | 0x80 : byte);
+        } while (payload);
+    }
+};
+
+/** Relative weights of the event kinds produced by TrafficGenerator */
+struct TrafficMix {
+    uint32_t messages = 8;    /* Send<T> of a random Message alternative */
+    uint32_t functions = 8;   /* -finstrument-functions enter or exit */
+    uint32_t cycleCounts = 1; /* CYCLE_COUNT word without a message */
+    uint32_t console = 1;     /* A line of console output */
+    bool records = false;     /* Records, cycle deltas and function events, as with SPOR_COMPACT_RECORDS */
+};
+
+/**
+ * Generates a realistic SWO stream from a spor target: messages framed like spor::Send, instrumented function
+ * calls, cycle counts, console output, local timestamps and periodic sync packets.
+ */
+class TrafficGenerator {
+public:
+    /** An instrumented function entry or exit, with the cycle count it was sent at */
+    struct FunctionCall {
+        uint32_t function;
+        bool exit;
+        uint32_t cycles;
+
+        bool operator==(const FunctionCall &) const = default;
+    };
+
+    SwoWriter writer;
+    size_t events = 0;
+    /* Every function entry and exit that was generated, to check what a decoder makes of them */
+    std::vector<FunctionCall> calls;
+
+    explicit TrafficGenerator(const TrafficMix &mix = {}, uint64_t seed = 1) : mix_(mix), state_(seed | 1) {
+        writer.Sync();
+    }
+
+    void Generate(size_t count) {
+        const uint32_t total = mix_.messages + mix_.functions + mix_.cycleCounts + mix_.console;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t pick = static_cast<uint32_t>(Next() % total);
+            if (pick < mix_.messages) {
+                SendRandomMessage();
+            } else if ((pick -= mix_.messages) < mix_.functions) {
+                CallOrReturn();
+            } else if ((pick -= mix_.functions) < mix_.cycleCounts) {
+                CycleCount();
+            } else {
+                ConsoleLine();
+            }
+
+            ++events;
+            if (events % 8 == 0) {
+                writer.LocalTimestamp(static_cast<uint32_t>(Next() % 300));
+            }
+            if (events % SYNC_INTERVAL == 0) {
+                writer.Sync();
+            }
+        }
+    }
+
+    /** Same packets as spor::Send<T>: cycle count, [type, length] header, payload, or a single record */
+    template <typename T>
+    void Send(const T &message) {
+        std::array<std::byte, 100> buffer;
+        zpp::bits::out out(buffer, zpp::bits::size_varint{});
+        if (zpp::bits::failure(out(message))) {
+            return;
+        }
+
+        const auto length = static_cast<uint32_t>(out.position());
+        if (mix_.records) {
+            SendRecord(static_cast<uint8_t>(::Message(message).index()), std::span(buffer).first(length));
+            SendSequenceIfDue();
+            return;
+        }
+
+        CycleCount();
+        writer.Software(Channel::MESSAGE_TYPE, static_cast<uint32_t>(::Message(message).index()) | length << 8, 2);
+        writer.Software(Channel::MESSAGE_DATA, std::span(buffer).first(length));
+        SendSequenceIfDue();
+    }
+
+private:
+    static constexpr size_t SYNC_INTERVAL = 1024;
+    static constexpr uint32_t TASKS = 8;
+    static constexpr uint32_t MAX_CALL_DEPTH = 24;
+
+    TrafficMix mix_;
+    uint64_t state_;
+    uint32_t cycles_ = 0;
+    uint32_t cycleBase_ = 0;
+    uint32_t eventsSinceAnchor_ = RECORD_ANCHOR_INTERVAL;
+    uint32_t functionBase_ = 0;
+    uint32_t functionsSinceAddress_ = RECORD_ANCHOR_INTERVAL;
+    uint16_t messagesSent_ = 0;
+    std::array<uint32_t, MAX_CALL_DEPTH> callStack_{};
+    uint32_t callDepth_ = 0;
+
+    uint64_t Next() {
+        /* xorshift64 */
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return state_;
+    }
+
+    const std::string &Name() {
+        static const std::array<std::string, 6> names{
+            "idle", "network", "display_refresh", "sensor_poll", "usb", "a_somewhat_longer_name_for_a_zone"
+        };
+        return names[Next() % names.size()];
+    }
+
+    /** Advances the clock and sends it the way spor::SendCycleCount does */
+    void CycleCount() {
+        cycles_ += 40 + static_cast<uint32_t>(Next() % 400);
+        if (!mix_.records || SendCycleAnchorIfDue()) {
+            writer.Software(Channel::CYCLE_COUNT, cycles_);
+            cycleBase_ = cycles_;
+            return;
+        }
+
+        std::array<std::byte, sizeof(uint32_t)> varint{};
+        const size_t size = WriteVarint(varint.data(), cycles_ - cycleBase_);
+        cycleBase_ = cycles_;
+        writer.Software(Channel::CYCLE_DELTA, std::span(varint).first(size == 3 ? 4 : size));
+    }
+
+    void SendSequenceIfDue() {
+        if (++messagesSent_ % SEQUENCE_INTERVAL == 0) {
+            writer.Software(Channel::SEQUENCE, messagesSent_, 2);
+        }
+    }
+
+    bool SendCycleAnchorIfDue() {
+        if (++eventsSinceAnchor_ < RECORD_ANCHOR_INTERVAL && cycles_ - cycleBase_ < CYCLE_DELTA_LIMIT) {
+            return false;
+        }
+        eventsSinceAnchor_ = 0;
+        return true;
+    }
+
+    void SendRecord(uint8_t type, std::span<const std::byte> payload) {
+        cycles_ += 40 + static_cast<uint32_t>(Next() % 400);
+        if (SendCycleAnchorIfDue()) {
+            writer.Software(Channel::CYCLE_COUNT, cycles_);
+            cycleBase_ = cycles_;
+        }
+
+        std::array<std::byte, RECORD_MAX_HEADER_SIZE + 100> record;
+        size_t size = 0;
+        record[size++] = static_cast<std::byte>(type);
+        size += WriteVarint(&record[size], cycles_ - cycleBase_);
+        size += WriteVarint(&record[size], static_cast<uint32_t>(payload.size()));
+        std::copy(payload.begin(), payload.end(), record.begin() + size);
+        size += payload.size();
+        cycleBase_ = cycles_;
+
+        writer.Software(Channel::RECORD, std::span(record).first(size));
+    }
+
+    template <typename T>
+    T MakeMessage() {
+        T message{};
+        const uint32_t handle = 0x20001000 + static_cast<uint32_t>(Next() % TASKS) * 0x100;
+        if constexpr (requires { message.handle = handle; }) {
+            message.handle = handle;
+        }
+        if constexpr (requires { message.ptr = handle; }) {
+            message.ptr = handle;
+        }
+        if constexpr (requires { message.name = StringOrSymbol(); }) {
+            message.name = StringOrSymbol(Name());
+        }
+        if constexpr (requires { message.text = StringOrSymbol(); }) {
+            message.text = StringOrSymbol(Name());
+        }
+        return message;
+    }
+
+    template <size_t Index>
+    void SendAlternative() {
+        Send(MakeMessage<std::variant_alternative_t<Index, ::Message>>());
+    }
+
+    void SendRandomMessage() {
+        static constexpr auto table = []<size_t... Is>(std::index_sequence<Is...>) {
+            return std::array{&TrafficGenerator::SendAlternative<Is>...};
+        }(std::make_index_sequence<std::variant_size_v<::Message>>{});
+
+        (this->*table[Next() % table.size()])();
+    }
+
+    void CallOrReturn() {
+        const bool enter = callDepth_ == 0 || (callDepth_ < MAX_CALL_DEPTH && Next() % 2 == 0);
+        if (enter) {
+            callStack_[callDepth_++] = 0x08000000 + static_cast<uint32_t>(Next() % 2048) * 0x40 + 1;
+        }
+        const uint32_t function = enter ? callStack_[callDepth_ - 1] : callStack_[--callDepth_];
+
+        if (mix_.records) {
+            FunctionEvent(function, !enter);
+        } else {
+            CycleCount();
+            writer.Software(enter ? Channel::FUNCTION_ENTER : Channel::FUNCTION_EXIT, function);
+        }
+        calls.push_back({function, !enter, cycles_});
+        SendSequenceIfDue();
+    }
+
+    /** Same packets as spor::SendFunctionEvent */
+    void FunctionEvent(uint32_t function, bool exit) {
+        cycles_ += 40 + static_cast<uint32_t>(Next() % 400);
+        const uint32_t cycleDelta = cycles_ - cycleBase_;
+        const uint32_t addressDelta = function - functionBase_;
+        const bool anchored = SendCycleAnchorIfDue();
+        cycleBase_ = cycles_;
+        functionBase_ = function;
+
+        if (anchored) {
+            writer.Software(Channel::CYCLE_COUNT, cycles_);
+        } else if (++functionsSinceAddress_ < RECORD_ANCHOR_INTERVAL) {
+            uint32_t word;
+            if (EncodeFunctionEvent(FUNCTION_EVENT_SHORT, exit, addressDelta, cycleDelta, word)) {
+                writer.Software(Channel::FUNCTION_EVENT, word, 2);
+                return;
+            }
+            if (EncodeFunctionEvent(FUNCTION_EVENT_LONG, exit, addressDelta, cycleDelta, word)) {
+                writer.Software(Channel::FUNCTION_EVENT, word, 4);
+                return;
+            }
+        }
+
+        if (!anchored) {
+            std::array<std::byte, sizeof(uint32_t)> varint{};
+            const size_t size = WriteVarint(varint.data(), cycleDelta);
+            writer.Software(Channel::CYCLE_DELTA, std::span(varint).first(size == 3 ? 4 : size));
+        }
+        functionsSinceAddress_ = 0;
+        writer.Software(exit ? Channel::FUNCTION_EXIT : Channel::FUNCTION_ENTER, function);
+    }
+
+    void ConsoleLine() {
+        const std::string line = "[" + std::to_string(cycles_) + "] " + Name() + " ok\n";
+        writer.Software(Channel::CONSOLE_LOG, std::as_bytes(std::span(line)));
+    }
+};
+
+}
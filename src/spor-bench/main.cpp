@@ -0,0 +1,10 @@
+#include <cstdlib>
+
+#include "Bench.hpp"
+
+int main() {
+    const bool equivalent = bench::RunOrbcatBenchmarks();
+    const bool allocationFree = bench::RunDecoderBenchmarks();
+    const bool cycleCountsCorrect = bench::RunHostBenchmarks();
+    return equivalent && allocationFree && cycleCountsCorrect ? 0 : EXIT_FAILURE;
+}
@@ -10,6 +10,19 @@ enum class Channel : uint8_t {
     CYCLE_COUNT,
     FUNCTION_ENTER,
     FUNCTION_EXIT,
+    RECORD,         /* Compact framing, see Record.hpp */
+    CYCLE_DELTA,    /* Varint cycle count delta, see Record.hpp */
+    FUNCTION_EVENT, /* Compact function entry and exit, see Record.hpp */
+    SEQUENCE,       /* 16-bit count of the messages sent so far, see SEQUENCE_INTERVAL */
+    ZONE,           /* Zone name pointer, with ZONE_END_FLAG set for the end of the zone */
     _NUM_CHANNELS,
 };
-static_assert(static_cast<int>(Channel::_NUM_CHANNELS) <= 32);
\ No newline at end of file
+static_assert(static_cast<int>(Channel::_NUM_CHANNELS) <= 32);
+
+/* The target sends its message count on Channel::SEQUENCE after every this many messages and function events, so
+ * the host can tell how many were lost in between */
+constexpr uint32_t SEQUENCE_INTERVAL = 256;
+
+/* Zone names are string literals, which need not be aligned, so the end flag is in the top bit. Flash and SRAM are
+ * below 0x40000000 on Cortex-M; names at higher addresses are sent as ZoneBeginData/ZoneEndData messages instead. */
+constexpr uint32_t ZONE_END_FLAG = 1u << 31;
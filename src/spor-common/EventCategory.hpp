@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "Messages.hpp"
+
+/**
+ * Bits of the target's `spor_event_mask`. An event is only sent while its category bit is set, so the mask can be
+ * changed at runtime (e.g. by a debugger, see scripts/spor-event-mask.gdb) to trade detail for SWO bandwidth.
+ */
+enum class EventCategory : uint32_t {
+    SCHEDULER = 1 << 0,     /* Task creation, switches, readying, priorities, delays */
+    QUEUE = 1 << 1,         /* Queues, semaphores and mutexes */
+    NOTIFY = 1 << 2,        /* Task notifications */
+    TIMER = 1 << 3,         /* Software timers */
+    EVENT_GROUP = 1 << 4,   /* Event groups */
+    STREAM_BUFFER = 1 << 5, /* Stream and message buffers */
+    INTERRUPT = 1 << 6,     /* Interrupt entry and exit */
+    ZONE = 1 << 7,          /* Zones, plots, messages and flows */
+    MEMORY = 1 << 8,        /* Allocations */
+    FUNCTION = 1 << 9,      /* -finstrument-functions entry and exit */
+    CONSOLE = 1 << 10,      /* Retargeted _write output */
+    SYSTEM = 1 << 11,       /* System info and the names and types of pointers */
+};
+
+constexpr uint32_t EVENT_CATEGORY_ALL = 0xFFFFFFFF;
+
+constexpr std::array<std::pair<std::string_view, EventCategory>, 12> EVENT_CATEGORY_NAMES{{
+    {"scheduler", EventCategory::SCHEDULER},
+    {"queue", EventCategory::QUEUE},
+    {"notify", EventCategory::NOTIFY},
+    {"timer", EventCategory::TIMER},
+    {"event_group", EventCategory::EVENT_GROUP},
+    {"stream_buffer", EventCategory::STREAM_BUFFER},
+    {"interrupt", EventCategory::INTERRUPT},
+    {"zone", EventCategory::ZONE},
+    {"memory", EventCategory::MEMORY},
+    {"function", EventCategory::FUNCTION},
+    {"console", EventCategory::CONSOLE},
+    {"system", EventCategory::SYSTEM},
+}};
+
+template <typename T, typename... Types>
+constexpr bool IsOneOf = (std::is_same_v<T, Types> || ...);
+
+template <typename T>
+constexpr EventCategory GetEventCategory() {
+    if constexpr (IsOneOf<
+                      T, FreertosTaskCreatedMessage, FreertosTaskSwitchedInMessage, FreertosTaskSwitchedOutMessage,
+                      FreertosTaskReadiedMessage, FreertosTaskDeletedMessage, FreertosTaskPrioritySetMessage,
+                      FreertosTaskSuspendMessage, FreertosTaskResumeMessage, FreertosTaskDelayMessage,
+                      FreertosTaskDelayUntilMessage>) {
+        return EventCategory::SCHEDULER;
+    } else if constexpr (IsOneOf<
+                             T, FreertosQueueCreatedMessage, FreertosQueueDeletedMessage,
+                             FreertosQueueRegistryMessage, FreertosQueueCreateFailedMessage,
+                             FreertosQueueSendMessage, FreertosQueueSendFailedMessage, FreertosQueueReceiveMessage,
+                             FreertosQueueReceiveFailedMessage, FreertosQueuePeekMessage,
+                             FreertosQueuePeekFailedMessage>) {
+        return EventCategory::QUEUE;
+    } else if constexpr (IsOneOf<T, FreertosTaskNotifyMessage, FreertosTaskNotifyReceivedMessage>) {
+        return EventCategory::NOTIFY;
+    } else if constexpr (IsOneOf<
+                             T, FreertosTimerCreatedMessage, FreertosTimerCreateFailedMessage,
+                             FreertosTimerCommandMessage, FreertosTimerCommandReceivedMessage,
+                             FreertosTimerExpiredMessage>) {
+        return EventCategory::TIMER;
+    } else if constexpr (IsOneOf<
+                             T, FreertosEventGroupCreatedMessage, FreertosEventGroupCreateFailedMessage,
+                             FreertosEventGroupDeletedMessage, FreertosEventGroupSyncMessage,
+                             FreertosEventGroupWaitBitsMessage, FreertosEventGroupClearBitsMessage,
+                             FreertosEventGroupSetBitsMessage>) {
+        return EventCategory::EVENT_GROUP;
+    } else if constexpr (IsOneOf<
+                             T, FreertosStreamBufferCreatedMessage, FreertosStreamBufferCreateFailedMessage,
+                             FreertosStreamBufferDeletedMessage, FreertosStreamBufferSendMessage,
+                             FreertosStreamBufferSendFailedMessage, FreertosStreamBufferReceiveMessage,
+                             FreertosStreamBufferReceiveFailedMessage, FreertosStreamBufferResetMessage>) {
+        return EventCategory::STREAM_BUFFER;
+    } else if constexpr (IsOneOf<
+                             T, InterruptConfigMessage, InterruptEnterData, InterruptExitData,
+                             FreertosIsrEnterMessage, FreertosIsrExitMessage, FreertosIsrExitToSchedulerMessage>) {
+        return EventCategory::INTERRUPT;
+    } else if constexpr (IsOneOf<
+                             T, ZoneBeginData, ZoneEndData, ZoneTextMessage, ZoneValueData, ZoneColorData,
+                             PlotMessage, PlotConfigMessage, MessageTextMessage, FlowBeginMessage,
+                             FlowEndMessage>) {
+        return EventCategory::ZONE;
+    } else if constexpr (IsOneOf<T, AllocMessage, FreeMessage>) {
+        return EventCategory::MEMORY;
+    } else if constexpr (IsOneOf<T, FunctionTraceEnterData, FunctionTraceExitData>) {
+        return EventCategory::FUNCTION;
+    } else {
+        return EventCategory::SYSTEM;
+    }
+}
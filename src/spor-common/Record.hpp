@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/*
+ * Compact message framing on Channel::RECORD. Each record is
+ *
+ *     [type] [cycle delta, varint] [payload length, varint] [payload]
+ *
+ * and records follow each other back-to-back, so the ITM writes are not aligned to them. The cycle delta is
+ * relative to the previous record, CYCLE_COUNT or CYCLE_DELTA packet, modulo 2^32. CYCLE_COUNT packets are only
+ * sent between records, so the host also uses them to resynchronise.
+ *
+ * Timestamps of events outside of records (function entry and exit, console output) are sent the same way: as a
+ * varint delta on Channel::CYCLE_DELTA, which is a single ITM write of 1, 2 or 4 bytes.
+ */
+
+constexpr size_t RECORD_MAX_VARINT_SIZE = 5;
+constexpr size_t RECORD_MAX_HEADER_SIZE = 1 + 2 * RECORD_MAX_VARINT_SIZE;
+
+/* Longer records are treated as corrupt */
+constexpr uint32_t RECORD_MAX_PAYLOAD_SIZE = 4096;
+
+/* The target sends an absolute CYCLE_COUNT every this many timestamps */
+constexpr uint32_t RECORD_ANCHOR_INTERVAL = 256;
+
+/* Longer gaps are sent as an absolute CYCLE_COUNT, so a CYCLE_DELTA varint fits in one 32-bit write */
+constexpr uint32_t CYCLE_DELTA_LIMIT = 1u << 28;
+
+/** LEB128. Returns the number of bytes written to `out`, which needs room for RECORD_MAX_VARINT_SIZE. */
+constexpr size_t WriteVarint(std::byte *out, uint32_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = static_cast<std::byte>(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = static_cast<std::byte>(value);
+    return size;
+}
+
+/** Returns the number of bytes read, or 0 when `data` ends within the varint */
+constexpr size_t ReadVarint(std::span<const std::byte> data, uint32_t &value) {
+    value = 0;
+    for (size_t i = 0; i < data.size() && i < RECORD_MAX_VARINT_SIZE; ++i) {
+        const auto byte = static_cast<uint32_t>(data[i]);
+        value |= (byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80) || i + 1 == RECORD_MAX_VARINT_SIZE) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function entry and exit on Channel::FUNCTION_EVENT, as deltas to the previous function address and timestamp:
+ *
+ *     16-bit write: [exit:1] [address delta / 2, signed:7] [cycle delta:8]
+ *     32-bit write: [exit:1] [address delta / 2, signed:20] [cycle delta:11]
+ *
+ * Events that fit neither are sent the old way, the full address on FUNCTION_ENTER or FUNCTION_EXIT, which also
+ * gives the host the address later deltas are relative to. The target does so at least every
+ * RECORD_ANCHOR_INTERVAL function events, and right after each absolute CYCLE_COUNT.
+ */
+struct FunctionEventFormat {
+    uint32_t addressBits;
+    uint32_t cycleBits;
+};
+
+constexpr FunctionEventFormat FUNCTION_EVENT_SHORT{7, 8};
+constexpr FunctionEventFormat FUNCTION_EVENT_LONG{20, 11};
+
+/** Packs a function event into `word`, or returns false when the deltas do not fit `format` */
+constexpr bool EncodeFunctionEvent(
+    FunctionEventFormat format, bool exit, uint32_t addressDelta, uint32_t cycleDelta, uint32_t &word
+) {
+    /* Thumb function addresses are all odd, so the delta is always even */
+    const auto halfwords = static_cast<int32_t>(addressDelta) / 2;
+    const int32_t limit = 1 << (format.addressBits - 1);
+    if ((addressDelta & 1) || halfwords < -limit || halfwords >= limit || cycleDelta >= (1u << format.cycleBits)) {
+        return false;
+    }
+    const uint32_t addressMask = (1u << format.addressBits) - 1;
+    word = static_cast<uint32_t>(exit) | (static_cast<uint32_t>(halfwords) & addressMask) << 1 |
+           cycleDelta << (1 + format.addressBits);
+    return true;
+}
+
+/** Inverse of EncodeFunctionEvent, `addressDelta` is modulo 2^32 */
+constexpr void DecodeFunctionEvent(
+    FunctionEventFormat format, uint32_t word, bool &exit, uint32_t &addressDelta, uint32_t &cycleDelta
+) {
+    const uint32_t addressMask = (1u << format.addressBits) - 1;
+    const uint32_t signBit = 1u << (format.addressBits - 1);
+    const uint32_t halfwords = (word >> 1) & addressMask;
+    exit = word & 1;
+    addressDelta = ((halfwords ^ signBit) - signBit) * 2;
+    cycleDelta = (word >> (1 + format.addressBits)) & ((1u << format.cycleBits) - 1);
+}
@@ -1,38 +1,97 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+
 #ifdef SPOR_HOST
+#include <unordered_map>
+
 #include "symbol-resolver/SymbolResolver.hpp"
 #endif
 
+#ifndef SPOR_HOST
+/* Bounds of the flash, defined by the linker script (see the target README). Weak, so linking works without them. */
+extern "C" const char __spor_rom_start[] __attribute__((weak));
+extern "C" const char __spor_rom_end[] __attribute__((weak));
+
+namespace spor {
+/**
+ * Looks up `str` in the target's string table (transport/StringTable.cpp). Returns false if the string is not interned,
+ * otherwise its `id`, and whether the text has to be sent along (`define`).
+ */
+bool InternString(const char *str, uint16_t &id, bool &define);
+
+/** Clears the slot of `id`, so that the next use of the string defines it again */
+void ForgetString(uint16_t id);
+}
+#endif
+
+/* Used when the linker script does not define the flash bounds */
+#ifndef spor_ROM_START
+#define spor_ROM_START 0x8000000
+#endif
+#ifndef spor_ROM_END
+#define spor_ROM_END 0x9000000
+#endif
+
 inline bool IsSymbolInROM(const void *ptr) {
-    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr)) > 0x8000000 &&
-           static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr)) < 0x9000000;
+    uint32_t start = spor_ROM_START;
+    uint32_t end = spor_ROM_END;
+#ifndef SPOR_HOST
+    if (__spor_rom_start != nullptr && __spor_rom_end != nullptr) {
+        start = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(__spor_rom_start));
+        end = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(__spor_rom_end));
+    }
+#endif
+    const auto address = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr));
+    return address >= start && address < end;
 }
 
 class StringOrSymbol {
 public:
-    enum class Type : uint8_t { String, Symbol };
+    enum class Type : uint8_t { String, Symbol, Interned };
+
+#ifdef SPOR_HOST
+    /* On the host a decoded string is a view into the decode buffer, see Relocate */
+    using StringType = std::string_view;
+#else
+    using StringType = std::string;
+#endif
+
+    /** A RAM string from the target's string table. The text is only sent with the first use of the id. */
+    struct InternedString {
+        uint16_t id;
+        StringType text;
+
+        constexpr static auto serialize(auto &archive, auto &self) {
+            return archive(self.id, self.text);
+        }
+    };
 
     StringOrSymbol() = default;
-    StringOrSymbol(const std::string &str) : data_(str) {}
+    StringOrSymbol(const std::string &str) : data_(StringType(str)) {}
+#ifndef SPOR_HOST
     StringOrSymbol(std::string &&str) : data_(std::move(str)) {}
+#endif
     StringOrSymbol(uint32_t symbol_ptr) : data_(symbol_ptr) {}
     StringOrSymbol(const char *str) {
         if (str && IsSymbolInROM(str)) {
             data_ = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(str));
         } else if (str) {
-            data_ = std::string(str);
+            data_ = StringType(str);
         } else {
-            data_ = std::string();
+            data_ = StringType();
         }
     }
 
     Type GetType() const {
-        return std::holds_alternative<std::string>(data_) ? Type::String : Type::Symbol;
+        return static_cast<Type>(data_.index());
     }
 
-    const std::string &AsString() const {
-        return std::get<std::string>(data_);
+    const StringType &AsString() const {
+        return std::get<StringType>(data_);
     }
 
     uint32_t AsSymbol() const {
@@ -45,18 +104,83 @@ public:
     bool IsSymbol() const {
         return GetType() == Type::Symbol;
     }
+    bool IsInterned() const {
+        return GetType() == Type::Interned;
+    }
     bool HasData() const {
-        return IsString() ? !AsString().empty() : AsSymbol() != 0;
+        switch (GetType()) {
+        case Type::String:
+            return !AsString().empty();
+        case Type::Symbol:
+            return AsSymbol() != 0;
+        default:
+            return true;
+        }
     }
 
     constexpr static auto serialize(auto &archive, auto &self) {
         return archive(self.data_);
     }
 
+#ifndef SPOR_HOST
+    /**
+     * Replaces a RAM string with its id in the string table, keeping the text when this use defines the id. Send does
+     * this under the lock that puts the message on the wire, so no use of an id can go out before its definition.
+     * Returns whether the id was defined.
+     */
+    bool Intern() {
+        auto *text = std::get_if<StringType>(&data_);
+        uint16_t id;
+        bool define;
+        if (!text || text->empty() || !spor::InternString(text->c_str(), id, define)) {
+            return false;
+        }
+        data_ = InternedString{id, define ? std::move(*text) : StringType()};
+        return define;
+    }
+
+    /** Undoes the definition made by Intern, for a message that was not sent after all */
+    void ForgetInterned() {
+        if (auto *interned = std::get_if<InternedString>(&data_); interned && !interned->text.empty()) {
+            spor::ForgetString(interned->id);
+        }
+    }
+#endif
+
 #ifdef SPOR_HOST
+    /** Re-points the string at `store(view)`, which has to outlive the decode buffer */
+    void Relocate(auto &&store) {
+        if (auto *view = std::get_if<StringType>(&data_)) {
+            *view = store(*view);
+        } else if (auto *interned = std::get_if<InternedString>(&data_); interned && !interned->text.empty()) {
+            interned->text = store(interned->text);
+        }
+    }
+
+    /**
+     * Replaces an interned string with its text. Definitions are recorded in `table`, so this has to be called for
+     * every message in the order the target sent them.
+     */
+    void ResolveInterned(std::unordered_map<uint16_t, std::string> &table) {
+        auto *interned = std::get_if<InternedString>(&data_);
+        if (!interned) {
+            return;
+        }
+        auto [it, inserted] = table.try_emplace(interned->id);
+        if (!interned->text.empty()) {
+            it->second = interned->text;
+        } else if (inserted) {
+            /* The definition was lost; the target sends it again after a while */
+            it->second = "<string #" + std::to_string(interned->id) + ">";
+        }
+        data_ = StringType(it->second);
+    }
+
     std::string GetString() const {
         if (this->IsString()) {
-            return this->AsString();
+            return std::string(this->AsString());
+        } else if (auto *interned = std::get_if<InternedString>(&data_)) {
+            return std::string(interned->text);
         } else {
             return profiler::GetResolvedSymbolInfo(this->AsSymbol()).value;
         }
@@ -72,5 +196,6 @@ public:
 #endif
 
 private:
-    std::variant<std::string, uint32_t> data_;
+    /* The order is part of the wire format */
+    std::variant<StringType, uint32_t, InternedString> data_;
 };
@@ -1,24 +1,41 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Dispatcher.hpp"
 #include "spor-common/Messages.hpp"
+#include "spor-common/Record.hpp"
 #include "zpp_bits.h"
 
-enum class DecoderState { WAITING_FOR_TYPE, RECEIVING_DATA };
+/**
+ * RECEIVING_DATA is used for captures from targets that send only the message type; the message is then found by
+ * trying to decode the buffered data. RECEIVING_FRAMED_DATA is used when the type packet also carries the payload
+ * length, so the message is decoded exactly once.
+ */
+enum class DecoderState { WAITING_FOR_TYPE, RECEIVING_DATA, RECEIVING_FRAMED_DATA };
 
 class IMessageHandler {
 public:
     virtual ~IMessageHandler() = default;
 
+    /** Interned strings are replaced by their text first, so the handlers only see plain strings and symbols */
     template <typename T>
     void OnMessage(const T &msg) {
-        HandleMessage(msg);
+        if constexpr (requires(InternedStringResolver &resolver, T &message) { T::serialize(resolver, message); }) {
+            T resolved = msg;
+            InternedStringResolver resolver{internedStrings_};
+            T::serialize(resolver, resolved);
+            HandleMessage(resolved);
+        } else {
+            HandleMessage(msg);
+        }
     }
 
     virtual void HandleMessage(const ZoneBeginData &msg) = 0;
@@ -90,30 +107,412 @@ public:
 
     virtual void OnCycleCount(uint32_t cycles) = 0;
     virtual void OnConsoleLog(const void *data, size_t length) = 0;
+
+    /** ITM timestamp of the CYCLE_COUNT packet just passed to OnCycleCount */
+    virtual void OnItmTimestamp(uint64_t) {}
+
+    /** Messages missing according to Channel::SEQUENCE, 0 when more arrived than were sent (mis-framed data) */
+    virtual void OnDataLost(uint32_t) {}
+
+private:
+    /* Text of the target's interned strings by id */
+    std::unordered_map<uint16_t, std::string> internedStrings_;
+
+    /** Stands in for a zpp_bits archive to find the strings of a message through its serialize() */
+    struct InternedStringResolver {
+        std::unordered_map<uint16_t, std::string> &table;
+
+        std::errc operator()(auto &...members) {
+            (Resolve(members), ...);
+            return {};
+        }
+
+        void Resolve(StringOrSymbol &string) {
+            string.ResolveInterned(table);
+        }
+
+        void Resolve(const auto &) {}
+    };
 };
 
-class MessageDecoder {
+/**
+ * Reassembles messages from the ITM channels and dispatches them to `Handler`, which needs the OnMessage,
+ * OnCycleCount and OnConsoleLog members of IMessageHandler but does not have to derive from it. OnItmTimestamp and
+ * OnDataLost are optional.
+ *
+ * Strings in a message are views into the decode buffer and are only valid during the OnMessage call; a handler
+ * that keeps a message has to relocate them (see EventCollector).
+ */
+template <typename Handler>
+class BasicMessageDecoder {
 public:
-    MessageDecoder(IMessageHandler &handler);
+    explicit BasicMessageDecoder(Handler &handler) : handler_(handler), dispatcher_(handler_) {}
 
-    static MessageDecoder *GetInstance();
+    void ProcessChannelData(uint8_t channel, uint64_t timestamp, std::span<const std::byte> data);
+
+    /** True while a console line has been started but not terminated */
+    bool HasPendingConsoleLog() const {
+        return !consoleBuffer.empty();
+    }
 
-    void ProcessChannelData(uint8_t channel, uint64_t timestamp, std::span<std::byte> data);
+    uint64_t UnknownMessageCount() const {
+        return dispatcher_.UnknownMessageCount();
+    }
+
+    /**
+     * Called on an ITM overflow, which drops packets of any channel. Deltas would then apply to a wrong base, so
+     * records and function events are ignored until the next CYCLE_COUNT and full function address, and partial
+     * messages are dropped.
+     */
+    void OnOverflow() {
+        recordsSynced = false;
+        functionsSynced = false;
+        recordBuffer.clear();
+        Reset();
+    }
 
 private:
-    void OnMessage(uint8_t messageTypeIndex, std::span<std::byte> data);
+    void OnMessage(uint8_t messageTypeIndex, std::span<const std::byte> data);
 
     DecoderState state = DecoderState::WAITING_FOR_TYPE;
     uint8_t currentMessageTypeIndex;
+    size_t expectedLength = 0;
     std::vector<uint8_t> messageBuffer;
     std::vector<uint8_t> consoleBuffer;
 
-    IMessageHandler &handler_;
-    MessageDispatcher<IMessageHandler> dispatcher_;
+    /* Unparsed tail of the RECORD stream and the cycle count that record and CYCLE_DELTA deltas are relative to.
+     * Deltas are only used after a CYCLE_COUNT packet, which the target sends before its first delta. */
+    std::vector<uint8_t> recordBuffer;
+    uint32_t recordCycles = 0;
+    bool recordsSynced = false;
+
+    /* Address that FUNCTION_EVENT deltas are relative to, known after the first FUNCTION_ENTER or FUNCTION_EXIT */
+    uint32_t functionBase = 0;
+    bool functionsSynced = false;
+
+    /* The target's message count that the next SEQUENCE packet should have, known after the first one */
+    uint16_t expectedSequence = 0;
+    bool sequenceSynced = false;
+
+    Handler &handler_;
+    MessageDispatcher<Handler> dispatcher_;
 
     void HandleMessageType(uint8_t type);
-    void HandleMessageData(std::span<std::byte> data);
-    void HandleConsoleLog(std::span<std::byte> data);
+    void HandleFramedMessageType(std::span<const std::byte> header);
+    void HandleMessageData(std::span<const std::byte> data);
+    void HandleFramedMessageData(std::span<const std::byte> data);
+    void ProcessFramedMessage();
+    void HandleConsoleLog(std::span<const std::byte> data);
+    void HandleRecordData(std::span<const std::byte> data);
+    void HandleFunctionEvent(std::span<const std::byte> data);
+    void OnFunction(bool exit, uint32_t function);
+    void HandleSequence(uint16_t sequence);
+    size_t ParseRecords(std::span<const std::byte> data);
     void TryProcessMessage();
     void Reset();
-};
\ No newline at end of file
+};
+
+class MessageDecoder : public BasicMessageDecoder<IMessageHandler> {
+public:
+    using BasicMessageDecoder::BasicMessageDecoder;
+
+    static MessageDecoder *GetInstance();
+};
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::ProcessChannelData(
+    uint8_t channel, uint64_t timestamp, std::span<const std::byte> data
+) {
+    Channel ch = static_cast<Channel>(channel);
+
+    switch (ch) {
+    case Channel::MESSAGE_TYPE:
+        if (data.size() == 1) {
+            HandleMessageType(static_cast<uint8_t>(data[0]));
+        } else if (data.size() >= 2) {
+            HandleFramedMessageType(data);
+        }
+        break;
+
+    case Channel::MESSAGE_DATA:
+        if (state == DecoderState::RECEIVING_DATA) {
+            HandleMessageData(data);
+        } else if (state == DecoderState::RECEIVING_FRAMED_DATA) {
+            HandleFramedMessageData(data);
+        }
+        break;
+
+    case Channel::CYCLE_COUNT:
+        if (data.size() == 4) {
+            uint32_t cycles;
+            std::memcpy(&cycles, data.data(), sizeof(cycles));
+            handler_.OnCycleCount(cycles);
+            if constexpr (requires { handler_.OnItmTimestamp(timestamp); }) {
+                handler_.OnItmTimestamp(timestamp);
+            }
+
+            /* Sent between records only, so anything still buffered is a broken record */
+            recordBuffer.clear();
+            recordCycles = cycles;
+            recordsSynced = true;
+        }
+        break;
+
+    case Channel::RECORD:
+        HandleRecordData(data);
+        break;
+
+    case Channel::FUNCTION_ENTER:
+    case Channel::FUNCTION_EXIT:
+        if (data.size() == 4) {
+            uint32_t function;
+            std::memcpy(&function, data.data(), sizeof(function));
+            functionBase = function;
+            functionsSynced = true;
+            OnFunction(ch == Channel::FUNCTION_EXIT, function);
+        }
+        break;
+
+    case Channel::FUNCTION_EVENT:
+        HandleFunctionEvent(data);
+        break;
+
+    case Channel::ZONE:
+        if (data.size() == 4) {
+            uint32_t word;
+            std::memcpy(&word, data.data(), sizeof(word));
+            ++expectedSequence;
+            if (word & ZONE_END_FLAG) {
+                handler_.OnMessage(ZoneEndData{word & ~ZONE_END_FLAG});
+            } else {
+                handler_.OnMessage(ZoneBeginData{word});
+            }
+        }
+        break;
+
+    case Channel::CYCLE_DELTA:
+        if (uint32_t delta; recordsSynced && ReadVarint(data, delta) != 0) {
+            recordCycles += delta;
+            handler_.OnCycleCount(recordCycles);
+        }
+        break;
+
+    case Channel::CONSOLE_LOG:
+        HandleConsoleLog(data);
+        break;
+
+    case Channel::SEQUENCE:
+        if (data.size() == 2) {
+            uint16_t sequence;
+            std::memcpy(&sequence, data.data(), sizeof(sequence));
+            HandleSequence(sequence);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::OnMessage(uint8_t messageTypeIndex, std::span<const std::byte> data) {
+    ++expectedSequence;
+    dispatcher_.DispatchMessage(messageTypeIndex, data);
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::HandleSequence(uint16_t sequence) {
+    const auto missing = static_cast<int16_t>(sequence - expectedSequence);
+    if (sequenceSynced && missing != 0) {
+        if constexpr (requires { handler_.OnDataLost(uint32_t{}); }) {
+            handler_.OnDataLost(missing > 0 ? static_cast<uint32_t>(missing) : 0);
+        }
+    }
+    expectedSequence = sequence;
+    sequenceSynced = true;
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::HandleMessageType(uint8_t type) {
+    if (state == DecoderState::RECEIVING_DATA && !messageBuffer.empty()) {
+        TryProcessMessage();
+    }
+    currentMessageTypeIndex = type;
+    state = DecoderState::RECEIVING_DATA;
+    messageBuffer.clear();
+}
+
+/** Header is [type, length] or [type, length low, length high, 0] */
+template <typename Handler>
+void BasicMessageDecoder<Handler>::HandleFramedMessageType(std::span<const std::byte> header) {
+    /* Buffered data of an older unframed message is still tried; an unfinished framed message is dropped */
+    if (state == DecoderState::RECEIVING_DATA && !messageBuffer.empty()) {
+        TryProcessMessage();
+    }
+
+    currentMessageTypeIndex = static_cast<uint8_t>(header[0]);
+    expectedLength = static_cast<size_t>(header[1]);
+    if (header.size() == 4) {
+        expectedLength |= static_cast<size_t>(header[2]) << 8;
+    }
+    state = DecoderState::RECEIVING_FRAMED_DATA;
+    messageBuffer.clear();
+
+    if (expectedLength == 0) {
+        ProcessFramedMessage();
+    }
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::HandleFramedMessageData(std::span<const std::byte> data) {
+    /* The whole message is in this packet, decode it in place */
+    if (messageBuffer.empty() && data.size() >= expectedLength) {
+        OnMessage(currentMessageTypeIndex, data.first(expectedLength));
+        Reset();
+        return;
+    }
+
+    auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+    const size_t count = std::min(data.size(), expectedLength - messageBuffer.size());
+    messageBuffer.insert(messageBuffer.end(), bytes, bytes + count);
+
+    if (messageBuffer.size() == expectedLength) {
+        ProcessFramedMessage();
+    }
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::ProcessFramedMessage() {
+    OnMessage(currentMessageTypeIndex, std::as_bytes(std::span(messageBuffer)));
+    Reset();
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::HandleMessageData(std::span<const std::byte> data) {
+    auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+    messageBuffer.insert(messageBuffer.end(), bytes, bytes + data.size());
+
+    TryProcessMessage();
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::TryProcessMessage() {
+    if (messageBuffer.empty()) {
+        return;
+    }
+
+    std::span<const std::byte> messageSpan = std::as_bytes(std::span(messageBuffer));
+
+    if (dispatcher_.CanDecodeMessage(currentMessageTypeIndex, messageSpan)) {
+        OnMessage(currentMessageTypeIndex, messageSpan);
+        Reset();
+    }
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::Reset() {
+    state = DecoderState::WAITING_FOR_TYPE;
+    messageBuffer.clear();
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::HandleRecordData(std::span<const std::byte> data) {
+    if (!recordsSynced) {
+        return;
+    }
+    if (recordBuffer.empty()) {
+        data = data.subspan(ParseRecords(data));
+        auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+        recordBuffer.assign(bytes, bytes + data.size());
+        return;
+    }
+
+    auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+    recordBuffer.insert(recordBuffer.end(), bytes, bytes + data.size());
+    const size_t consumed = ParseRecords(std::as_bytes(std::span(recordBuffer)));
+    recordBuffer.erase(recordBuffer.begin(), recordBuffer.begin() + static_cast<std::ptrdiff_t>(consumed));
+}
+
+/** Dispatches the complete records at the start of `data` and returns how many bytes they took */
+template <typename Handler>
+size_t BasicMessageDecoder<Handler>::ParseRecords(std::span<const std::byte> data) {
+    size_t consumed = 0;
+    while (consumed < data.size()) {
+        const auto record = data.subspan(consumed);
+
+        uint32_t delta;
+        uint32_t length;
+        size_t header = 1;
+        const size_t deltaSize = ReadVarint(record.subspan(header), delta);
+        if (deltaSize == 0) {
+            break;
+        }
+        header += deltaSize;
+        const size_t lengthSize = ReadVarint(record.subspan(header), length);
+        if (lengthSize == 0) {
+            break;
+        }
+        header += lengthSize;
+
+        if (length > RECORD_MAX_PAYLOAD_SIZE) {
+            /* Lost sync, skip everything up to the next CYCLE_COUNT */
+            recordsSynced = false;
+            return data.size();
+        }
+        if (record.size() - header < length) {
+            break;
+        }
+
+        recordCycles += delta;
+        handler_.OnCycleCount(recordCycles);
+        OnMessage(static_cast<uint8_t>(record[0]), record.subspan(header, length));
+        consumed += header + length;
+    }
+    return consumed;
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::HandleFunctionEvent(std::span<const std::byte> data) {
+    if (!recordsSynced || !functionsSynced || (data.size() != 2 && data.size() != 4)) {
+        return;
+    }
+
+    uint32_t word = 0;
+    std::memcpy(&word, data.data(), data.size());
+    bool exit;
+    uint32_t addressDelta;
+    uint32_t cycleDelta;
+    DecodeFunctionEvent(
+        data.size() == 2 ? FUNCTION_EVENT_SHORT : FUNCTION_EVENT_LONG, word, exit, addressDelta, cycleDelta
+    );
+
+    recordCycles += cycleDelta;
+    handler_.OnCycleCount(recordCycles);
+    functionBase += addressDelta;
+    OnFunction(exit, functionBase);
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::OnFunction(bool exit, uint32_t function) {
+    ++expectedSequence;
+    if (exit) {
+        handler_.OnMessage(FunctionTraceExitData{function});
+    } else {
+        handler_.OnMessage(FunctionTraceEnterData{function});
+    }
+}
+
+template <typename Handler>
+void BasicMessageDecoder<Handler>::HandleConsoleLog(std::span<const std::byte> data) {
+    for (const auto &byteVal : data) {
+        uint8_t byte = static_cast<uint8_t>(byteVal);
+        if (byte == 0 || byte == '\n') {
+            if (!consoleBuffer.empty()) {
+                handler_.OnConsoleLog(consoleBuffer.data(), consoleBuffer.size());
+                consoleBuffer.clear();
+            }
+        } else {
+            consoleBuffer.push_back(byte);
+        }
+    }
+}
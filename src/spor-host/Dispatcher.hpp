@@ -1,10 +1,13 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <span>
 #include <type_traits>
 #include <typeinfo>
 #include <utility>
+#include <variant>
 
 #include "spor-common/Messages.hpp"
 #include "zpp_bits.h"
@@ -14,42 +17,58 @@ class MessageDispatcher {
 public:
     explicit MessageDispatcher(Handler &handler) : handler_(handler) {}
 
-    bool DispatchMessage(uint8_t messageTypeIndex, std::span<std::byte> data, Args &&...args) {
-        return DispatchMessageImpl(
-            messageTypeIndex, data, std::forward<Args>(args)...,
-            std::make_index_sequence<std::variant_size_v<Message>>{}
-        );
+    bool DispatchMessage(uint8_t messageTypeIndex, std::span<const std::byte> data, Args &&...args) {
+        static constexpr auto table = MakeDispatchTable(std::make_index_sequence<MESSAGE_COUNT>{});
+
+        if (messageTypeIndex >= MESSAGE_COUNT) {
+            ++unknownMessages_;
+            return false;
+        }
+        return (this->*table[messageTypeIndex])(data, std::forward<Args>(args)...);
+    }
+
+    bool CanDecodeMessage(uint8_t messageTypeIndex, std::span<const std::byte> data) {
+        static constexpr auto table = MakeCanDecodeTable(std::make_index_sequence<MESSAGE_COUNT>{});
+
+        if (messageTypeIndex >= MESSAGE_COUNT) {
+            return false;
+        }
+        return (this->*table[messageTypeIndex])(data);
     }
 
-    bool CanDecodeMessage(uint8_t messageTypeIndex, std::span<std::byte> data) {
-        return CanDecodeMessageImpl(messageTypeIndex, data, std::make_index_sequence<std::variant_size_v<Message>>{});
+    /** Messages dropped because their type index is not in the Message variant */
+    uint64_t UnknownMessageCount() const {
+        return unknownMessages_;
     }
 
 private:
+    static constexpr std::size_t MESSAGE_COUNT = std::variant_size_v<Message>;
+
+    using DispatchFunction = bool (MessageDispatcher::*)(std::span<const std::byte>, Args &&...);
+    using CanDecodeFunction = bool (MessageDispatcher::*)(std::span<const std::byte>);
+
+    /* Per-type functions indexed by message type, so dispatch does not depend on the number of types */
     template <std::size_t... Is>
-    bool DispatchMessageImpl(
-        uint8_t messageTypeIndex, std::span<std::byte> data, Args &&...args, std::index_sequence<Is...>
-    ) {
-        bool handled = false;
-        (void)((messageTypeIndex == Is ? (handled = DecodeAndHandle<Is>(data, std::forward<Args>(args)...), true)
-                                       : false) ||
-               ...);
-        return handled;
+    static constexpr std::array<DispatchFunction, sizeof...(Is)> MakeDispatchTable(std::index_sequence<Is...>) {
+        return {&MessageDispatcher::DecodeAndHandle<Is>...};
     }
 
     template <std::size_t... Is>
-    bool CanDecodeMessageImpl(uint8_t messageTypeIndex, std::span<std::byte> data, std::index_sequence<Is...>) {
-        bool canDecode = false;
-        (void)((messageTypeIndex == Is ? (canDecode = CanDecode<Is>(data), true) : false) || ...);
-        return canDecode;
+    static constexpr std::array<CanDecodeFunction, sizeof...(Is)> MakeCanDecodeTable(std::index_sequence<Is...>) {
+        return {&MessageDispatcher::CanDecode<Is>...};
+    }
+
+    /* Read as chars so zpp_bits decodes strings as views into `data` instead of copying them */
+    static std::span<const char> AsChars(std::span<const std::byte> data) {
+        return {reinterpret_cast<const char *>(data.data()), data.size()};
     }
 
     template <std::size_t Index>
-    bool DecodeAndHandle(std::span<std::byte> data, Args &&...args) {
+    bool DecodeAndHandle(std::span<const std::byte> data, Args &&...args) {
         using MessageType = std::variant_alternative_t<Index, Message>;
 
         MessageType message;
-        zpp::bits::in in(data, zpp::bits::size_varint{});
+        zpp::bits::in in(AsChars(data), zpp::bits::size_varint{});
         auto result = in(message);
 
         if (zpp::bits::failure(result)) {
@@ -80,17 +99,18 @@ private:
     }
 
     template <std::size_t Index>
-    bool CanDecode(std::span<std::byte> data) {
+    bool CanDecode(std::span<const std::byte> data) {
         using MessageType = std::variant_alternative_t<Index, Message>;
 
         MessageType message;
-        zpp::bits::in testIn(data, zpp::bits::size_varint{});
+        zpp::bits::in testIn(AsChars(data), zpp::bits::size_varint{});
         auto result = testIn(message);
 
         return !zpp::bits::failure(result);
     }
 
     Handler &handler_;
+    uint64_t unknownMessages_ = 0;
 };
 
 template <typename BaseClass>
@@ -0,0 +1,242 @@
+#include "HeapTracker.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <utility>
+
+#include "PerfettoApi.hpp"
+
+namespace {
+
+constexpr std::string_view HEAP_COUNTER = "Heap";
+
+std::string_view TaskName(uint32_t task) {
+    if (task == 0) {
+        return "<no task>";
+    }
+    auto it = profiler::PerfettoApi::threads.find(task);
+    return it != profiler::PerfettoApi::threads.end() ? std::string_view(it->second.name) : "<unknown task>";
+}
+
+void WriteUsage(std::ostream &out, std::string_view label, const HeapTracker::Usage &usage) {
+    out << "  " << std::setw(10) << usage.bytes << std::setw(10) << usage.peakBytes << std::setw(8) << usage.blocks
+        << std::setw(10) << usage.allocations << std::setw(10) << usage.frees << "  " << label << std::endl;
+}
+
+}
+
+void HeapTracker::Alloc(TargetPointer ptr, uint32_t size, uint32_t task, std::string_view name) {
+    if (ptr == 0) {
+        ++failedAllocations_;
+        return;
+    }
+
+    if (Block *stale = Find(ptr)) {
+        ++replacedBlocks_;
+        Remove(*stale);
+        Erase(stale);
+    }
+    const Block block{.ptr = ptr, .size = size, .task = task, .name = NameIndex(name)};
+    Insert(block);
+    Add(block);
+}
+
+void HeapTracker::Free(TargetPointer ptr) {
+    if (ptr == 0) {
+        return;
+    }
+    Block *block = Find(ptr);
+    if (!block) {
+        ++unknownFrees_;
+        return;
+    }
+    Remove(*block);
+    Erase(block);
+}
+
+size_t HeapTracker::Slot(TargetPointer ptr) const {
+    /* Blocks are at least 8-byte aligned, the multiplication spreads the remaining bits over the upper half */
+    return static_cast<size_t>((uint64_t(ptr >> 3) * 0x9E3779B97F4A7C15ull) >> 32) & (blocks_.size() - 1);
+}
+
+HeapTracker::Block *HeapTracker::Find(TargetPointer ptr) {
+    if (blocks_.empty()) {
+        return nullptr;
+    }
+    const size_t mask = blocks_.size() - 1;
+    for (size_t i = Slot(ptr);; i = (i + 1) & mask) {
+        if (blocks_[i].ptr == ptr) {
+            return &blocks_[i];
+        }
+        if (blocks_[i].ptr == 0) {
+            return nullptr;
+        }
+    }
+}
+
+void HeapTracker::Insert(const Block &block) {
+    if ((live_ + 1) * 4 > blocks_.size() * 3) {
+        Grow();
+    }
+    const size_t mask = blocks_.size() - 1;
+    size_t i = Slot(block.ptr);
+    while (blocks_[i].ptr != 0) {
+        i = (i + 1) & mask;
+    }
+    blocks_[i] = block;
+    ++live_;
+}
+
+void HeapTracker::Erase(Block *block) {
+    /* Backward shift: later blocks of the same probe run move up, so that no tombstones are needed */
+    const size_t mask = blocks_.size() - 1;
+    size_t hole = static_cast<size_t>(block - blocks_.data());
+    for (size_t i = (hole + 1) & mask; blocks_[i].ptr != 0; i = (i + 1) & mask) {
+        const size_t home = Slot(blocks_[i].ptr);
+        /* A block stays when its home slot is cyclically after the hole, up to where it is */
+        const bool stays = hole <= i ? hole < home && home <= i : hole < home || home <= i;
+        if (!stays) {
+            blocks_[hole] = blocks_[i];
+            hole = i;
+        }
+    }
+    blocks_[hole].ptr = 0;
+    --live_;
+}
+
+void HeapTracker::Grow() {
+    const size_t capacity = std::max(MIN_CAPACITY, blocks_.size() * 2);
+    std::vector<Block> old = std::exchange(blocks_, std::vector<Block>(capacity));
+    live_ = 0;
+    for (const auto &block : old) {
+        if (block.ptr != 0) {
+            Insert(block);
+        }
+    }
+}
+
+uint32_t HeapTracker::NameIndex(std::string_view name) {
+    if (name.empty()) {
+        return 0;
+    }
+    auto it = nameIndices_.find(name);
+    if (it != nameIndices_.end()) {
+        return it->second;
+    }
+    const auto index = static_cast<uint32_t>(names_.size());
+    names_.push_back({std::string(name), std::string(HEAP_COUNTER) + " " + std::string(name), {}});
+    nameIndices_.emplace(name, index);
+    return index;
+}
+
+void HeapTracker::Add(const Block &block) {
+    auto add = [&](Usage &usage) {
+        usage.bytes += block.size;
+        usage.peakBytes = std::max(usage.peakBytes, usage.bytes);
+        ++usage.blocks;
+        ++usage.allocations;
+        return static_cast<int64_t>(usage.bytes);
+    };
+
+    profiler::PerfettoApi::Plot(HEAP_COUNTER, add(total_));
+    const int64_t taskBytes = add(tasks_[block.task]);
+    if (block.task != 0) {
+        profiler::PerfettoApi::Plot(HEAP_COUNTER, taskBytes, block.task);
+    }
+    if (block.name != 0) {
+        auto &name = names_[block.name];
+        profiler::PerfettoApi::Plot(name.counterName, add(name.usage));
+    }
+}
+
+void HeapTracker::Remove(const Block &block) {
+    auto remove = [&](Usage &usage) {
+        usage.bytes -= block.size;
+        --usage.blocks;
+        ++usage.frees;
+        return static_cast<int64_t>(usage.bytes);
+    };
+
+    /* Frees count against the task that allocated the block */
+    profiler::PerfettoApi::Plot(HEAP_COUNTER, remove(total_));
+    const int64_t taskBytes = remove(tasks_[block.task]);
+    if (block.task != 0) {
+        profiler::PerfettoApi::Plot(HEAP_COUNTER, taskBytes, block.task);
+    }
+    if (block.name != 0) {
+        auto &name = names_[block.name];
+        profiler::PerfettoApi::Plot(name.counterName, remove(name.usage));
+    }
+}
+
+void HeapTracker::WriteReport(std::ostream &out, size_t leaksShown) const {
+    out << "Heap: " << total_.allocations << " allocations, " << total_.frees << " frees, " << failedAllocations_
+        << " failed allocations, " << unknownFrees_ << " frees of unknown blocks, " << replacedBlocks_
+        << " blocks allocated again without a free" << std::endl;
+    out << "  peak " << total_.peakBytes << " bytes, " << total_.bytes << " bytes in " << total_.blocks
+        << " blocks at the end" << std::endl;
+
+    out << "Heap per task:" << std::endl;
+    out << "       bytes      peak  blocks    allocs     frees" << std::endl;
+    std::vector<std::pair<uint32_t, const Usage *>> tasks;
+    for (const auto &[task, usage] : tasks_) {
+        tasks.emplace_back(task, &usage);
+    }
+    std::sort(tasks.begin(), tasks.end(), [](const auto &a, const auto &b) {
+        return a.second->peakBytes > b.second->peakBytes;
+    });
+    for (const auto &[task, usage] : tasks) {
+        WriteUsage(out, TaskName(task), *usage);
+    }
+
+    if (names_.size() > 1) {
+        out << "Heap per name:" << std::endl;
+        std::vector<const Name *> names;
+        for (size_t i = 1; i < names_.size(); ++i) {
+            names.push_back(&names_[i]);
+        }
+        std::sort(names.begin(), names.end(), [](const Name *a, const Name *b) {
+            return a->usage.peakBytes > b->usage.peakBytes;
+        });
+        for (const auto *name : names) {
+            WriteUsage(out, name->name, name->usage);
+        }
+    }
+
+    if (live_ == 0) {
+        return;
+    }
+
+    /* Leaks are grouped by where they came from, which is more telling than a list of addresses */
+    struct Leak {
+        uint64_t bytes = 0;
+        uint64_t blocks = 0;
+        TargetPointer example = 0;
+    };
+    std::map<std::pair<uint32_t, uint32_t>, Leak> groups;
+    for (const auto &block : blocks_) {
+        if (block.ptr != 0) {
+            auto &leak = groups[{block.task, block.name}];
+            leak.bytes += block.size;
+            ++leak.blocks;
+            leak.example = leak.example ? std::min(leak.example, block.ptr) : block.ptr;
+        }
+    }
+    std::vector<std::pair<std::pair<uint32_t, uint32_t>, Leak>> leaks(groups.begin(), groups.end());
+    std::sort(leaks.begin(), leaks.end(), [](const auto &a, const auto &b) {
+        return a.second.bytes > b.second.bytes;
+    });
+    leaks.resize(std::min(leaks.size(), leaksShown));
+
+    out << "Possibly leaked, still allocated at the end of the capture:" << std::endl;
+    for (const auto &[origin, leak] : leaks) {
+        const auto &[task, name] = origin;
+        out << "  " << std::setw(10) << leak.bytes << " bytes in " << std::setw(6) << leak.blocks << " blocks  "
+            << TaskName(task);
+        if (name != 0) {
+            out << ", " << names_[name].name;
+        }
+        out << "  (0x" << std::hex << leak.example << std::dec << ")" << std::endl;
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "spor-common/TargetPointer.hpp"
+
+/**
+ * Model of the target's heap from the allocations and frees it reports. Live blocks are kept in an open-addressing
+ * table keyed by their address, which costs one entry per live block and no allocation per operation once the table
+ * has grown to the peak number of blocks.
+ *
+ * Bytes in use are counted in total, per allocating task and per allocation name, with their high-water marks, and
+ * written to counter tracks. Whatever is still allocated when the capture ends is reported as possibly leaked.
+ */
+class HeapTracker {
+public:
+    /** Heap use of one task or name, or of the whole heap */
+    struct Usage {
+        uint64_t bytes = 0;
+        uint64_t peakBytes = 0;
+        uint64_t blocks = 0;
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+    };
+
+    /** `task` is the task that was running, 0 outside of any task. A null `ptr` is a failed allocation. */
+    void Alloc(TargetPointer ptr, uint32_t size, uint32_t task, std::string_view name = {});
+    void Free(TargetPointer ptr);
+
+    bool HasAllocations() const {
+        return total_.allocations != 0 || failedAllocations_ != 0;
+    }
+
+    const Usage &Total() const {
+        return total_;
+    }
+
+    size_t LiveBlocks() const {
+        return live_;
+    }
+
+    /** Prints heap use per task and name, and the `leaksShown` largest groups of blocks that were never freed */
+    void WriteReport(std::ostream &out, size_t leaksShown = 10) const;
+
+private:
+    static constexpr size_t MIN_CAPACITY = 1024;
+
+    struct Block {
+        TargetPointer ptr = 0; /* 0 is an empty slot */
+        uint32_t size;
+        uint32_t task;
+        uint32_t name;
+    };
+
+    struct Name {
+        std::string name;
+        std::string counterName;
+        Usage usage;
+    };
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const {
+            return std::hash<std::string_view>{}(text);
+        }
+    };
+
+    /* Power of two in size, with linear probing. Kept at most three quarters full. */
+    std::vector<Block> blocks_;
+    size_t live_ = 0;
+
+    Usage total_;
+    std::unordered_map<uint32_t, Usage> tasks_;
+    /* Index 0 is for allocations without a name */
+    std::vector<Name> names_{1};
+    std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>> nameIndices_;
+
+    uint64_t failedAllocations_ = 0;
+    uint64_t unknownFrees_ = 0;   /* Blocks allocated before the capture started, or lost */
+    uint64_t replacedBlocks_ = 0; /* Allocations of an address that was never freed, after a lost free */
+
+    size_t Slot(TargetPointer ptr) const;
+    Block *Find(TargetPointer ptr);
+    void Insert(const Block &block);
+    void Erase(Block *block);
+    void Grow();
+
+    uint32_t NameIndex(std::string_view name);
+    void Add(const Block &block);
+    void Remove(const Block &block);
+};
@@ -4,13 +4,18 @@
 #include <cstdint>
 #include <iostream>
 #include <string>
+#include <thread>
 
 #include "orbcat/Orbcat.hpp"
 
 struct Options {
     std::string outputFile;
     std::string elfFile;
+    std::string samplesFile;
     uint32_t cpuFreq = 200'000'000;
+    bool pipeline = true;
+    bool deferredTransport = false;
+    unsigned decodeThreads = std::thread::hardware_concurrency();
     orbcat::Orbcat::Options orbcatOptions;
 
     static Options parseCommandLine(int argc, char *argv[]);
@@ -23,8 +28,28 @@ inline Options Options::parseCommandLine(int argc, char *argv[]) {
     args::ValueFlag<uint32_t> cpufreq(parser, "cpufreq", "CPU frequency in KHz", {"cpufreq"});
     args::ValueFlag<std::string> inputFile(parser, "input-file", "Input file", {"input-file"});
     args::Flag itmSync(parser, "itm-sync", "ITM sync enforcement", {"itm-sync"});
+    args::Flag targetTimestamps(
+        parser, "target-timestamps",
+        "Hold ITM packets back until their local timestamp, for exact exception trace times", {"target-timestamps"}
+    );
+    args::Flag deferredTransport(
+        parser, "deferred-transport",
+        "The target is built with SPOR_DEFERRED_TRANSPORT, older cycle counts are steps back rather than wraparounds",
+        {"deferred-transport"}
+    );
+    args::Flag noMmap(parser, "no-mmap", "Read the input file through a stream instead of mapping it", {"no-mmap"});
+    args::Flag noPipeline(
+        parser, "no-pipeline", "Decode on a single thread instead of the multi-stage pipeline", {"no-pipeline"}
+    );
+    args::ValueFlag<unsigned> decodeThreads(
+        parser, "decode-threads", "Threads for decoding an input file, 1 decodes it sequentially",
+        {"decode-threads"}
+    );
     args::ValueFlag<std::string> server(parser, "server", "Server and port specification", {"server"}, "localhost");
     args::ValueFlag<std::string> elfFile(parser, "elf-file", "Path to ELF file for symbol resolution", {"elf-file"});
+    args::ValueFlag<std::string> samplesFile(
+        parser, "samples-file", "Write the PC samples to this file as perf script text", {"samples-file"}
+    );
     args::ValueFlag<std::string> outputFile(
         parser, "output-file", "Perfetto output file", {"output-file"}, "trace.pftrace"
     );
@@ -49,9 +74,18 @@ inline Options Options::parseCommandLine(int argc, char *argv[]) {
     if (inputFile)
         options.orbcatOptions.inputFile = args::get(inputFile);
     options.orbcatOptions.itmSync = args::get(itmSync);
+    if (targetTimestamps)
+        options.orbcatOptions.timestampMode = orbcat::TimestampMode::TARGET_CYCLES;
+    options.deferredTransport = args::get(deferredTransport);
+    options.orbcatOptions.mapInputFile = !args::get(noMmap);
     options.orbcatOptions.server = args::get(server);
+    options.pipeline = !args::get(noPipeline);
+    if (decodeThreads)
+        options.decodeThreads = args::get(decodeThreads);
     if (elfFile)
         options.elfFile = args::get(elfFile);
+    if (samplesFile)
+        options.samplesFile = args::get(samplesFile);
     options.outputFile = args::get(outputFile);
 
     return options;
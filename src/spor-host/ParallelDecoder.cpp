@@ -0,0 +1,210 @@
+#include "ParallelDecoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "orbcat/StaticOrbcat.hpp"
+#include "spor-common/Channels.hpp"
+#include "SporHost.hpp"
+
+namespace {
+
+/**
+ * Returns the offset of the first synchronisation packet (five zero bytes and 0x80) at or after `from`. No other
+ * ITM packet can contain five zero bytes in a row, so this is a safe place to restart demuxing.
+ */
+size_t FindSync(std::span<const uint8_t> data, size_t from) {
+    constexpr size_t SYNC_ZEROS = 5;
+
+    size_t position = std::max(from, SYNC_ZEROS);
+    while (position < data.size()) {
+        auto *end = static_cast<const uint8_t *>(std::memchr(data.data() + position, 0x80, data.size() - position));
+        if (!end) {
+            break;
+        }
+        if (std::all_of(end - SYNC_ZEROS, end, [](uint8_t byte) { return byte == 0; })) {
+            return static_cast<size_t>(end - data.data()) - SYNC_ZEROS;
+        }
+        position = static_cast<size_t>(end - data.data()) + 1;
+    }
+    return data.size();
+}
+
+bool IsSoftware(const ChannelPacket &packet, Channel channel) {
+    return packet.packet.kind == orbcat::ItmPacket::Kind::SOFTWARE &&
+           packet.packet.channel == static_cast<uint8_t>(channel);
+}
+
+/**
+ * A MESSAGE_TYPE packet, or a CYCLE_COUNT that record and function deltas restart from: the target follows an
+ * anchor with a record or with a full function address.
+ */
+bool IsMessageStart(const ChannelPacket &packet, const ChannelPacket &next) {
+    return IsSoftware(packet, Channel::MESSAGE_TYPE) ||
+           (IsSoftware(packet, Channel::CYCLE_COUNT) &&
+            (IsSoftware(next, Channel::RECORD) || IsSoftware(next, Channel::FUNCTION_ENTER) ||
+             IsSoftware(next, Channel::FUNCTION_EXIT)));
+}
+
+std::vector<ChannelPacket>::iterator FindMessageStart(std::vector<ChannelPacket> &packets) {
+    auto start = std::adjacent_find(packets.begin(), packets.end(), IsMessageStart);
+    if (start == packets.end() && !packets.empty() && IsSoftware(packets.back(), Channel::MESSAGE_TYPE)) {
+        start = packets.end() - 1;
+    }
+    return start;
+}
+
+std::vector<ChannelPacket>
+Demux(std::span<const uint8_t> data, bool sequenceTimestamps, uint64_t &timestampAdvance) {
+    std::vector<ChannelPacket> packets;
+    packets.reserve(data.size() / 3);
+
+    DemuxSink sink{packets};
+    orbcat::ItmDemux<DemuxSink> demux(sink, sequenceTimestamps);
+    demux.Feed(data);
+    demux.Flush();
+
+    timestampAdvance = demux.CurrentTimestamp();
+    return packets;
+}
+
+}
+
+struct ParallelDecoder::ChunkResult {
+    /* Packets before the first message start, they continue the previous chunk */
+    std::vector<ChannelPacket> prologue;
+    /* False when the chunk has no message start at all, then everything is prologue */
+    bool hasMessageStart = false;
+    /* ITM timestamps are relative to the start of the chunk */
+    uint64_t timestampAdvance = 0;
+
+    EventCollector collector;
+    EventDecoder decoder{collector};
+};
+
+ParallelDecoder::ParallelDecoder(
+    std::span<const uint8_t> capture, SporHost &host, unsigned threads, bool sequenceTimestamps
+)
+    : capture_(capture), host_(host), threads_(std::max(threads, 1u)), sequenceTimestamps_(sequenceTimestamps) {}
+
+ParallelDecoder::~ParallelDecoder() = default;
+
+void ParallelDecoder::Run() {
+    SplitCapture();
+    results_.resize(chunks_.size());
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads_; ++i) {
+        workers.emplace_back(&ParallelDecoder::RunWorker, this);
+    }
+
+    for (size_t index = 0; index < chunks_.size(); ++index) {
+        std::unique_ptr<ChunkResult> result;
+        {
+            std::unique_lock lock(mutex_);
+            condition_.wait(lock, [&] { return results_[index] != nullptr; });
+            result = std::move(results_[index]);
+        }
+
+        Stitch(index, std::move(result));
+
+        {
+            std::lock_guard lock(mutex_);
+            emittedChunks_ = index + 1;
+        }
+        condition_.notify_all();
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    if (carried_) {
+        unknownMessages_ += carried_->decoder.UnknownMessageCount();
+    }
+}
+
+void ParallelDecoder::SplitCapture() {
+    size_t begin = 0;
+    while (begin < capture_.size()) {
+        size_t end = capture_.size() - begin > CHUNK_SIZE ? FindSync(capture_, begin + CHUNK_SIZE) : capture_.size();
+        chunks_.push_back(capture_.subspan(begin, end - begin));
+        begin = end;
+    }
+}
+
+void ParallelDecoder::RunWorker() {
+    /* Bounds the number of decoded chunks waiting to be emitted, and with it memory use */
+    const size_t window = 2 * static_cast<size_t>(threads_);
+
+    for (size_t index = nextChunk_++; index < chunks_.size(); index = nextChunk_++) {
+        {
+            std::unique_lock lock(mutex_);
+            condition_.wait(lock, [&] { return index < emittedChunks_ + window; });
+        }
+
+        auto result = DecodeChunk(index);
+
+        {
+            std::lock_guard lock(mutex_);
+            results_[index] = std::move(result);
+        }
+        condition_.notify_all();
+    }
+}
+
+std::unique_ptr<ParallelDecoder::ChunkResult> ParallelDecoder::DecodeChunk(size_t index) const {
+    auto result = std::make_unique<ChunkResult>();
+    auto packets = Demux(chunks_[index], sequenceTimestamps_, result->timestampAdvance);
+
+    /* The first chunk starts with a fresh decoder, like a sequential decode */
+    auto start = index == 0 ? packets.begin() : FindMessageStart(packets);
+    result->hasMessageStart = index == 0 || start != packets.end();
+    result->prologue.assign(packets.begin(), start);
+
+    DecodePackets(result->decoder, result->collector, std::span<const ChannelPacket>(start, packets.end()));
+    return result;
+}
+
+void ParallelDecoder::Stitch(size_t index, std::unique_ptr<ChunkResult> result) {
+    if (carried_) {
+        DecodePackets(carried_->decoder, carried_->collector, result->prologue);
+
+        if (result->hasMessageStart && carried_->decoder.HasPendingConsoleLog()) {
+            /* A console line is still open where the chunk decoder started, so its output is wrong. This needs a
+             * line split across a chunk boundary with a message in between, so simply decode the chunk again. */
+            uint64_t timestampAdvance = 0;
+            auto packets = Demux(chunks_[index], sequenceTimestamps_, timestampAdvance);
+            DecodePackets(
+                carried_->decoder, carried_->collector, std::span(packets).subspan(result->prologue.size())
+            );
+            Emit(carried_->collector, timestampBase_);
+            timestampBase_ += timestampAdvance;
+            return;
+        }
+
+        Emit(carried_->collector, timestampBase_);
+    }
+
+    Emit(result->collector, timestampBase_);
+    timestampBase_ += result->timestampAdvance;
+
+    if (result->hasMessageStart) {
+        if (carried_) {
+            unknownMessages_ += carried_->decoder.UnknownMessageCount();
+        }
+        carried_ = std::move(result);
+    }
+}
+
+void ParallelDecoder::Emit(EventCollector &collector, uint64_t timestampBase) {
+    for (auto &event : collector.events) {
+        if (auto *exception = std::get_if<ExceptionEvent>(&event)) {
+            exception->timestamp += timestampBase;
+        } else if (auto *itmTimestamp = std::get_if<ItmTimestampEvent>(&event)) {
+            itmTimestamp->timestamp += timestampBase;
+        }
+        ApplyEvent(host_, event);
+    }
+    collector.Clear();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "Pipeline.hpp"
+
+struct SporHost;
+
+/**
+ * Decodes a complete capture on a thread pool.
+ *
+ * The capture is split at ITM synchronisation packets, so each chunk can be demuxed from a fresh ItmDemux. Workers
+ * decode a chunk from its first message start (a MESSAGE_TYPE packet or a record anchor) onwards; the packets
+ * before it (the tail of a message or console line started in the previous chunk) are kept as a prologue. The
+ * emission thread then replays each prologue on the decoder carried over from the previous chunk, so a pending
+ * message type and buffer survive the boundary. Events are applied to SporHost strictly in capture order, which carries the current task and the
+ * cycle-count base across chunks as well.
+ */
+class ParallelDecoder {
+public:
+    ParallelDecoder(
+        std::span<const uint8_t> capture, SporHost &host, unsigned threads, bool sequenceTimestamps = false
+    );
+    ~ParallelDecoder();
+
+    /** Blocks until the whole capture has been applied to the host */
+    void Run();
+
+    /** Messages of a type the host does not know, valid after Run */
+    uint64_t UnknownMessageCount() const {
+        return unknownMessages_;
+    }
+
+private:
+    static constexpr size_t CHUNK_SIZE = 4 << 20;
+
+    struct ChunkResult;
+
+    std::span<const uint8_t> capture_;
+    SporHost &host_;
+    unsigned threads_;
+    bool sequenceTimestamps_;
+
+    std::vector<std::span<const uint8_t>> chunks_;
+    std::vector<std::unique_ptr<ChunkResult>> results_;
+    std::atomic<size_t> nextChunk_{0};
+    size_t emittedChunks_ = 0;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+
+    /* Decoder state carried from the last stitched chunk */
+    std::unique_ptr<ChunkResult> carried_;
+    uint64_t timestampBase_ = 0;
+    /* Counted from each decoder once it is no longer carried, so a chunk that is decoded again counts once */
+    uint64_t unknownMessages_ = 0;
+
+    void SplitCapture();
+    void RunWorker();
+    std::unique_ptr<ChunkResult> DecodeChunk(size_t index) const;
+    void Stitch(size_t index, std::unique_ptr<ChunkResult> result);
+    void Emit(EventCollector &collector, uint64_t timestampBase);
+};
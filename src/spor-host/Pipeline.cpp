@@ -0,0 +1,130 @@
+#include "Pipeline.hpp"
+
+#include <thread>
+
+#include "orbcat/StaticOrbcat.hpp"
+#include "SporHost.hpp"
+
+Pipeline::Pipeline(const orbcat::Orbcat::Options &options, SporHost &host)
+    : host_(host), sequenceTimestamps_(orbcat::IsTargetTimestampMode(options.timestampMode)) {
+    orbcat::MessageHandler handlers;
+    handlers.onRawData = [this](std::span<const uint8_t> data) {
+        rawRing_.Push(data);
+    };
+    orbcat_ = std::make_unique<orbcat::Orbcat>(options, std::move(handlers));
+
+    for (size_t i = 0; i < EVENT_BATCH_COUNT; i++) {
+        auto batch = std::make_unique<EventBatch>();
+        freeBatches_.Push(std::span(&batch, 1));
+    }
+}
+
+Pipeline::~Pipeline() = default;
+
+void Pipeline::Run() {
+    std::thread demux(&Pipeline::RunDemux, this);
+    std::thread decode(&Pipeline::RunDecode, this);
+    std::thread emission(&Pipeline::RunEmission, this);
+
+    orbcat_->Start();
+    rawRing_.Close();
+
+    demux.join();
+    decode.join();
+    emission.join();
+}
+
+void Pipeline::RunDemux() {
+    std::vector<uint8_t> buffer(64 << 10);
+    std::vector<ChannelPacket> packets;
+    packets.reserve(buffer.size());
+
+    DemuxSink sink{packets};
+    orbcat::ItmDemux<DemuxSink> demux(sink, sequenceTimestamps_);
+
+    while (size_t size = rawRing_.Pop(buffer)) {
+        demux.Feed(std::span(buffer).first(size));
+        packetRing_.Push(std::span(packets));
+        packets.clear();
+    }
+    demux.Flush();
+    packetRing_.Push(std::span(packets));
+    packetRing_.Close();
+}
+
+void Pipeline::RunDecode() {
+    EventCollector collector;
+    EventDecoder decoder(collector);
+    std::vector<ChannelPacket> packets(4096);
+    std::unique_ptr<EventBatch> batch;
+
+    while (size_t count = packetRing_.Pop(packets)) {
+        DecodePackets(decoder, collector, std::span(packets).first(count));
+        if (collector.events.empty()) {
+            continue;
+        }
+
+        /* Hand over the collected events with their strings and continue in an emptied batch */
+        freeBatches_.Pop(std::span(&batch, 1));
+        std::swap(static_cast<EventBatch &>(collector), *batch);
+        eventRing_.Push(std::span(&batch, 1));
+    }
+    unknownMessages_ = decoder.UnknownMessageCount();
+    eventRing_.Close();
+}
+
+void Pipeline::RunEmission() {
+    std::unique_ptr<EventBatch> batch;
+
+    while (eventRing_.Pop(std::span(&batch, 1))) {
+        for (const auto &event : batch->events) {
+            ApplyEvent(host_, event);
+        }
+        batch->Clear();
+        freeBatches_.Push(std::span(&batch, 1));
+    }
+}
+
+void DecodePackets(EventDecoder &decoder, EventCollector &collector, std::span<const ChannelPacket> packets) {
+    for (const auto &[packet, timestamp] : packets) {
+        if (packet.kind == orbcat::ItmPacket::Kind::EXCEPTION) {
+            collector.events.emplace_back(ExceptionEvent{
+                {static_cast<orbcat::ExceptionMessage::ExceptionEvent>(packet.status), packet.value}, timestamp
+            });
+        } else if (packet.kind == orbcat::ItmPacket::Kind::PC_SAMPLE) {
+            collector.events.emplace_back(PcSampleEvent{{packet.value, packet.status != 0}});
+        } else if (packet.kind == orbcat::ItmPacket::Kind::OVERFLOW) {
+            decoder.OnOverflow();
+            collector.events.emplace_back(OverflowEvent{});
+        } else {
+            decoder.ProcessChannelData(
+                packet.channel, timestamp, std::as_bytes(std::span(&packet.value, 1)).first(packet.size)
+            );
+        }
+    }
+}
+
+void ApplyEvent(SporHost &host, const HostEvent &event) {
+    if (auto *message = std::get_if<Message>(&event)) {
+        std::visit(
+            [&host](const auto &msg) {
+                host.OnMessage(msg);
+            },
+            *message
+        );
+    } else if (auto *cycles = std::get_if<CycleCountEvent>(&event)) {
+        host.OnCycleCount(cycles->cycles);
+    } else if (auto *log = std::get_if<ConsoleLogEvent>(&event)) {
+        host.OnConsoleLog(log->text.data(), log->text.size());
+    } else if (auto *exception = std::get_if<ExceptionEvent>(&event)) {
+        host.HandleException(exception->exception, exception->timestamp);
+    } else if (auto *itmTimestamp = std::get_if<ItmTimestampEvent>(&event)) {
+        host.OnItmTimestamp(itmTimestamp->timestamp);
+    } else if (auto *sample = std::get_if<PcSampleEvent>(&event)) {
+        host.HandlePcSample(sample->sample);
+    } else if (std::holds_alternative<OverflowEvent>(event)) {
+        host.HandleOverflow();
+    } else if (auto *lost = std::get_if<DataLostEvent>(&event)) {
+        host.OnDataLost(lost->messages);
+    }
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+#include "Decoder.hpp"
+#include "orbcat/ItmBlockDecoder.hpp"
+#include "orbcat/Orbcat.hpp"
+#include "spor-common/Messages.hpp"
+#include "SpscRing.hpp"
+#include "StringArena.hpp"
+
+struct SporHost;
+
+/** Output of the demux stage: one ITM software, exception, PC sample or overflow packet */
+struct ChannelPacket {
+    orbcat::ItmPacket packet;
+    uint64_t timestamp;
+};
+
+struct CycleCountEvent {
+    uint32_t cycles;
+};
+
+struct ConsoleLogEvent {
+    std::string_view text;
+};
+
+struct ExceptionEvent {
+    orbcat::ExceptionMessage exception;
+    uint64_t timestamp;
+};
+
+struct ItmTimestampEvent {
+    uint64_t timestamp;
+};
+
+struct PcSampleEvent {
+    orbcat::PcSample sample;
+};
+
+struct OverflowEvent {};
+
+struct DataLostEvent {
+    uint32_t messages;
+};
+
+/** Output of the decode stage, applied to SporHost in order by the emission stage */
+using HostEvent = std::variant<
+    Message, CycleCountEvent, ConsoleLogEvent, ExceptionEvent, ItmTimestampEvent, PcSampleEvent, OverflowEvent,
+    DataLostEvent>;
+
+/** ItmDemux sink for the demux stage, collects channel packets for the decode stage */
+struct DemuxSink {
+    std::vector<ChannelPacket> &packets;
+
+    void OnChannelData(uint8_t channel, uint64_t timestamp, std::span<const std::byte> data) {
+        uint32_t value = 0;
+        std::memcpy(&value, data.data(), data.size());
+        packets.push_back(
+            {{orbcat::ItmPacket::Kind::SOFTWARE, channel, static_cast<uint8_t>(data.size()), 0, value}, timestamp}
+        );
+    }
+
+    void OnException(const orbcat::ExceptionMessage &exception, uint64_t timestamp) {
+        packets.push_back(
+            {{orbcat::ItmPacket::Kind::EXCEPTION, 0, 0, static_cast<uint8_t>(exception.event),
+              exception.exceptionNumber},
+             timestamp}
+        );
+    }
+
+    void OnPcSample(const orbcat::PcSample &sample, uint64_t timestamp) {
+        packets.push_back(
+            {{orbcat::ItmPacket::Kind::PC_SAMPLE, 0, 0, static_cast<uint8_t>(sample.sleeping), sample.pc}, timestamp}
+        );
+    }
+
+    void OnOverflow(uint64_t timestamp) {
+        packets.push_back({{orbcat::ItmPacket::Kind::OVERFLOW, 0, 0, 0, 0}, timestamp});
+    }
+};
+
+/** Decoded events together with the arena holding their strings */
+struct EventBatch {
+    std::vector<HostEvent> events;
+    StringArena strings;
+
+    void Clear() {
+        events.clear();
+        strings.Reset();
+    }
+};
+
+/** BasicMessageDecoder handler for the decode stage, collects decoded messages instead of applying them */
+class EventCollector : public EventBatch {
+public:
+    template <typename T>
+    void OnMessage(const T &msg) {
+        auto &message = std::get<T>(std::get<Message>(events.emplace_back(std::in_place_type<Message>, msg)));
+        if constexpr (requires(StringRelocator &relocator) { T::serialize(relocator, message); }) {
+            StringRelocator relocator{strings};
+            T::serialize(relocator, message);
+        }
+    }
+
+    void OnCycleCount(uint32_t cycles) {
+        events.emplace_back(CycleCountEvent{cycles});
+    }
+
+    void OnItmTimestamp(uint64_t timestamp) {
+        events.emplace_back(ItmTimestampEvent{timestamp});
+    }
+
+    void OnDataLost(uint32_t messages) {
+        events.emplace_back(DataLostEvent{messages});
+    }
+
+    void OnConsoleLog(const void *data, size_t length) {
+        events.emplace_back(ConsoleLogEvent{strings.Store({static_cast<const char *>(data), length})});
+    }
+
+private:
+    /** Stands in for a zpp_bits archive to find the strings of a message through its serialize() */
+    struct StringRelocator {
+        StringArena &strings;
+
+        std::errc operator()(auto &...members) {
+            (Relocate(members), ...);
+            return {};
+        }
+
+        void Relocate(StringOrSymbol &string) {
+            string.Relocate([this](std::string_view text) {
+                return strings.Store(text);
+            });
+        }
+
+        void Relocate(const auto &) {}
+    };
+};
+
+using EventDecoder = BasicMessageDecoder<EventCollector>;
+
+/** Decode stage: reassembles messages from `packets`, hardware packets are passed through in order */
+void DecodePackets(EventDecoder &decoder, EventCollector &collector, std::span<const ChannelPacket> packets);
+
+/** Emission stage: applies one event to the host */
+void ApplyEvent(SporHost &host, const HostEvent &event);
+
+/**
+ * Runs the host as four threads connected by SPSC rings:
+ * - ingest: receives raw SWO data (Orbcat::Start)
+ * - demux: ITM decoding into channel packets (orbcat::ItmDemux)
+ * - decode: message reassembly and deserialization
+ * - emission: SporHost handlers and trace packet writes
+ *
+ * Every stage hands over whole batches. A slow stage makes the one before it wait, and the raw ring in front of
+ * the demux stage is sized to absorb several seconds of a saturated SWO link, so the receiver keeps draining the
+ * probe while later stages catch up.
+ */
+class Pipeline {
+public:
+    Pipeline(const orbcat::Orbcat::Options &options, SporHost &host);
+    ~Pipeline();
+
+    /** Blocks until the input ends and every stage has drained */
+    void Run();
+
+    /** Messages of a type the host does not know, valid after Run */
+    uint64_t UnknownMessageCount() const {
+        return unknownMessages_;
+    }
+
+private:
+    static constexpr size_t RAW_RING_SIZE = 16 << 20;
+    static constexpr size_t PACKET_RING_SIZE = 1 << 16;
+    /* Event batches in flight between the decode and emission stages, recycled through freeBatches_ */
+    static constexpr size_t EVENT_BATCH_COUNT = 16;
+
+    SporHost &host_;
+    std::unique_ptr<orbcat::Orbcat> orbcat_;
+    bool sequenceTimestamps_;
+    uint64_t unknownMessages_ = 0;
+
+    SpscRing<uint8_t> rawRing_{RAW_RING_SIZE};
+    SpscRing<ChannelPacket> packetRing_{PACKET_RING_SIZE};
+    SpscRing<std::unique_ptr<EventBatch>> eventRing_{EVENT_BATCH_COUNT};
+    SpscRing<std::unique_ptr<EventBatch>> freeBatches_{EVENT_BATCH_COUNT};
+
+    void RunDemux();
+    void RunDecode();
+    void RunEmission();
+};
@@ -0,0 +1,110 @@
+#include "SamplingProfiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "PerfettoApi.hpp"
+#include "symbol-resolver/SymbolResolver.hpp"
+
+namespace {
+
+std::string_view TaskName(uint32_t task) {
+    if (task == 0) {
+        return "<no task>";
+    }
+    auto it = profiler::PerfettoApi::threads.find(task);
+    return it != profiler::PerfettoApi::threads.end() ? std::string_view(it->second.name) : "<unknown task>";
+}
+
+const profiler::SymbolInfo *FindFunction(uint32_t pc) {
+    auto *resolver = profiler::GetSymbolResolver();
+    return resolver ? resolver->GetFunctionContaining(pc) : nullptr;
+}
+
+}
+
+void SamplingProfiler::AddSample(uint32_t task, const orbcat::PcSample &sample) {
+    auto &samples = tasks[task];
+    ++samples.total;
+
+    if (sample.sleeping) {
+        ++samples.sleeping;
+        return;
+    }
+    ++samples.pcs[sample.pc];
+
+    if (perfScript.is_open()) {
+        WritePerfScriptSample(task, sample.pc);
+    }
+}
+
+void SamplingProfiler::WriteReport(std::ostream &out, size_t functionsPerTask) const {
+    std::vector<std::pair<uint32_t, const TaskSamples *>> sortedTasks;
+    for (const auto &[task, samples] : tasks) {
+        sortedTasks.emplace_back(task, &samples);
+    }
+    std::sort(sortedTasks.begin(), sortedTasks.end(), [](const auto &a, const auto &b) {
+        return a.second->total > b.second->total;
+    });
+
+    out << "PC samples per task:" << std::endl;
+    for (const auto &[task, samples] : sortedTasks) {
+        /* Samples are aggregated per function only here, PCs within one function are summed up */
+        std::map<std::string_view, uint64_t> functions;
+        uint64_t unknown = 0;
+        for (const auto &[pc, count] : samples->pcs) {
+            if (auto *function = FindFunction(pc)) {
+                functions[function->name] += count;
+            } else {
+                unknown += count;
+            }
+        }
+        if (unknown) {
+            functions["<unknown>"] += unknown;
+        }
+        if (samples->sleeping) {
+            functions["<sleeping>"] += samples->sleeping;
+        }
+
+        std::vector<std::pair<std::string_view, uint64_t>> hottest(functions.begin(), functions.end());
+        std::sort(hottest.begin(), hottest.end(), [](const auto &a, const auto &b) {
+            return a.second > b.second;
+        });
+        hottest.resize(std::min(hottest.size(), functionsPerTask));
+
+        out << TaskName(task) << " (" << samples->total << " samples)" << std::endl;
+        for (const auto &[name, count] : hottest) {
+            out << "  " << std::fixed << std::setprecision(1) << std::setw(5)
+                << 100.0 * static_cast<double>(count) / static_cast<double>(samples->total) << "%  " << std::setw(8)
+                << count << "  " << name << std::endl;
+        }
+    }
+}
+
+bool SamplingProfiler::OpenPerfScript(const std::string &fileName) {
+    perfScript.open(fileName);
+    return perfScript.is_open();
+}
+
+const std::string &SamplingProfiler::FunctionName(uint32_t pc) {
+    auto [it, inserted] = functionNames.try_emplace(pc);
+    if (inserted) {
+        auto *function = FindFunction(pc);
+        it->second = function ? function->name : "[unknown]";
+    }
+    return it->second;
+}
+
+void SamplingProfiler::WritePerfScriptSample(uint32_t task, uint32_t pc) {
+    /* perf script names the thread by its comm and tid, with the time in seconds */
+    const uint64_t time = profiler::GetTime();
+    std::string name{TaskName(task)};
+    std::replace(name.begin(), name.end(), ' ', '_');
+
+    perfScript << name << ' ' << task << " [000] " << time / 1'000'000'000 << '.' << std::setfill('0')
+               << std::setw(6) << (time / 1'000) % 1'000'000 << std::setfill(' ') << ": 1 cpu-clock:\n\t"
+               << std::hex << pc << std::dec << ' ' << FunctionName(pc) << " (firmware)\n\n";
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "orbcat/Orbcat.hpp"
+
+/**
+ * Statistical profile from the DWT periodic PC samples. Samples are counted per task and PC while tracing, and only
+ * resolved to functions for the report, so a sample costs a hash map increment.
+ */
+class SamplingProfiler {
+public:
+    /** `task` is the task that was running when the sample was taken, 0 outside of any task */
+    void AddSample(uint32_t task, const orbcat::PcSample &sample);
+
+    bool HasSamples() const {
+        return !tasks.empty();
+    }
+
+    /** Prints the `functionsPerTask` hottest functions of every task */
+    void WriteReport(std::ostream &out, size_t functionsPerTask = 10) const;
+
+    /** Also writes every sample as `perf script` text, which the Perfetto UI opens as a CPU profile */
+    bool OpenPerfScript(const std::string &fileName);
+
+private:
+    struct TaskSamples {
+        std::unordered_map<uint32_t, uint64_t> pcs;
+        uint64_t sleeping = 0;
+        uint64_t total = 0;
+    };
+
+    std::unordered_map<uint32_t, TaskSamples> tasks;
+
+    std::ofstream perfScript;
+    /* Function names by PC for the perf script output, which needs one for every sample */
+    std::unordered_map<uint32_t, std::string> functionNames;
+
+    const std::string &FunctionName(uint32_t pc);
+    void WritePerfScriptSample(uint32_t task, uint32_t pc);
+};
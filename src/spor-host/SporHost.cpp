@@ -19,11 +19,11 @@ MessageDecoder *GetSporInstance() {
 }
 
 void SporHost::HandleMessage(const ZoneBeginData &msg) {
-    // profiler::PerfettoApi::ZoneBegin(nullptr, nullptr, nullptr, 0, 0);
+    State::ZoneBegin(msg.ptr);
 }
 
 void SporHost::HandleMessage(const ZoneEndData &msg) {
-    // profiler::PerfettoApi::ZoneEnd();
+    State::ZoneEnd();
 }
 
 void SporHost::HandleMessage(const ZoneTextMessage &msg) {
@@ -44,15 +44,15 @@ void SporHost::HandleMessage(const ZoneColorData &msg) {
 }
 
 void SporHost::HandleMessage(const PlotMessage &msg) {
-    if (msg.name.HasData() && msg.name.IsString()) {
-        profiler::PerfettoApi::Plot(msg.name.AsString(), msg.data.value);
+    if (msg.name.HasData()) {
+        profiler::PerfettoApi::Plot(ResolveString(msg.name), msg.data.value);
     }
 }
 
 void SporHost::HandleMessage(const PlotConfigMessage &msg) {
-    if (msg.name.HasData() && msg.name.IsString()) {
+    if (msg.name.HasData()) {
         profiler::PerfettoApi::PlotConfig(
-            msg.name.AsString(), msg.data.type, msg.data.step != 0, msg.data.fill != 0, msg.data.color
+            ResolveString(msg.name), msg.data.type, msg.data.step != 0, msg.data.fill != 0, msg.data.color
         );
     }
 }
@@ -65,27 +65,17 @@ void SporHost::HandleMessage(const MessageTextMessage &msg) {
 }
 
 void SporHost::HandleMessage(const AllocMessage &msg) {
-    std::string_view name;
-    if (msg.name.HasData() && msg.name.IsString()) {
-        name = msg.name.AsString();
-    }
-    profiler::PerfettoApi::Alloc(
-        reinterpret_cast<const void *>(static_cast<uintptr_t>(msg.data.ptr)), msg.data.size, name
-    );
+    heapTracker.Alloc(msg.data.ptr, msg.data.size, profiler::PerfettoApi::currentThreadId, ResolveString(msg.name));
 }
 
 void SporHost::HandleMessage(const FreeMessage &msg) {
-    std::string_view name;
-    if (msg.name.HasData() && msg.name.IsString()) {
-        name = msg.name.AsString();
-    }
-    profiler::PerfettoApi::Free(reinterpret_cast<const void *>(static_cast<uintptr_t>(msg.data.ptr)), name);
+    heapTracker.Free(msg.data.ptr);
 }
 
 void SporHost::HandleMessage(const FreertosTaskCreatedMessage &msg) {
     if (msg.name.HasData() && msg.name.IsString()) {
         const auto &name = msg.name.AsString();
-        tasks[msg.handle] = {name, msg.handle};
+        tasks[msg.handle] = {std::string(name), msg.handle};
         profiler::PerfettoApi::RegisterThread(msg.handle, name);
     }
 }
@@ -123,6 +113,7 @@ void SporHost::HandleMessage(const FlowEndMessage &msg) {
 
 void SporHost::HandleMessage(const SystemInfoData &msg) {
     cpuFrequencyHz.store(static_cast<uint64_t>(msg.clock_frequency_mhz) * 1000000);
+    profiler::SetClockFrequency(cpuFrequencyHz.load());
 }
 
 void SporHost::HandleMessage(const InterruptConfigMessage &msg) {
@@ -164,13 +155,23 @@ void SporHost::OnConsoleLog(const void *data, size_t length) {
     }
 }
 
-void SporHost::OnCycleCount(uint32_t cycles) {
-    static uint32_t lastCycles = cycles;
-    static uint64_t lastNanoseconds = 0;
-    uint32_t diff = cycles - lastCycles;
-    lastNanoseconds += diff * 5; // Todo
-    profiler::SetTime(lastNanoseconds);
-    lastCycles = cycles;
+void SporHost::OnCycleCount(uint32_t cycleCount) {
+    /* Modulo 2^32, so a wraparound between two timestamps still gives the right delta */
+    if (hasCycleCount) {
+        const auto delta = static_cast<uint32_t>(cycleCount - lastCycleCount);
+        /* With the deferred transport, queued events are drained after console output and function events that were
+         * stamped directly, so a delta of 2^31 or more is a count older than the last one. Those events are shown at
+         * the latest time, which stays the base for the next delta. That needs a timestamp every 2^31 cycles, about
+         * 10 s at 200 MHz, which is why it is only done for such targets. */
+        if (deferredTransport && delta >= 1u << 31) {
+            return;
+        }
+        cycles += delta;
+    }
+    lastCycleCount = cycleCount;
+    hasCycleCount = true;
+
+    profiler::PerfettoApi::SetTime(CyclesToNanoseconds(cycles));
 
     // if (cycles < lastTimestamp) {
     //     std::cerr << "Timestamps are not monotonic" << std::endl;
@@ -180,6 +181,15 @@ void SporHost::OnCycleCount(uint32_t cycles) {
     // lastTimestamp = timestamp;
 }
 
+void SporHost::OnItmTimestamp(uint64_t itmTimestamp) {
+    itmTimestampOffset = cycles - itmTimestamp;
+    hasItmTimestampOffset = true;
+}
+
+void SporHost::OnDataLost(uint32_t messages) {
+    HandleDataLost(messages);
+}
+
 void SporHost::HandleMessage(const PointerAnnounceMessage &msg) {
     uint32_t symbolAddr = msg.symbolPointer;
     uint32_t heapAddr = msg.heapPointer;
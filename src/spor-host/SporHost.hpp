@@ -80,8 +80,10 @@ struct SporHost : State, IMessageHandler {
     void HandleMessage(const PointerAnnounceMessage &msg) override;
     void HandleMessage(const PointerSetNameMessage &msg) override;
 
-    void OnCycleCount(uint32_t cycles) override;
+    void OnCycleCount(uint32_t cycleCount) override;
     void OnConsoleLog(const void *data, size_t length) override;
+    void OnItmTimestamp(uint64_t itmTimestamp) override;
+    void OnDataLost(uint32_t messages) override;
 
     SporHost() = default;
     SporHost(const SporHost &) = delete;
@@ -23,14 +23,9 @@ void SporHost::HandleMessage(const FreertosTaskSwitchedOutMessage &msg) {
     // Add a Track::Message for blocked thread reasons if there's additional info
     if (msg.blockedOnObject != 0) {
         auto it = tasks.find(msg.handle);
-        std::string message = "Task ";
-        if (it != tasks.end()) {
-            message += it->second.name;
-        } else {
-            message += std::to_string(msg.handle);
-        }
-        message += " blocked on object: " + std::to_string(msg.blockedOnObject);
-        profiler::PerfettoApi::Message(message);
+        const std::string message =
+            it != tasks.end() ? "Task " + it->second.name + " blocked on object" : "Task blocked on object";
+        profiler::PerfettoApi::Message(message, {{"task", msg.handle}, {"object", msg.blockedOnObject}});
     }
 }
 
@@ -78,7 +73,7 @@ void SporHost::HandleMessage(const FreertosQueueCreatedMessage &msg) {
 void SporHost::HandleMessage(const FreertosQueuePeekMessage &msg) {
     auto it = objects.find(msg.handle);
     if (it != objects.end()) {
-        profiler::PerfettoApi::Plot("Queue Depth", static_cast<int64_t>(msg.updatedCount));
+        profiler::PerfettoApi::Plot("Queue Depth", static_cast<int64_t>(msg.updatedCount), msg.handle);
     }
 }
 
@@ -93,7 +88,7 @@ void SporHost::HandleMessage(const FreertosQueueSendMessage &msg) {
         break;
     case QueueType::COUNTING_SEMAPHORE:
         profiler::PerfettoApi::LockableRelease(msg.handle);
-        profiler::PerfettoApi::Plot("CountingSem Count", static_cast<int64_t>(msg.updatedCount));
+        profiler::PerfettoApi::Plot("CountingSem Count", static_cast<int64_t>(msg.updatedCount), msg.handle);
         break;
     case QueueType::MUTEX:
     case QueueType::RECURSIVE_MUTEX:
@@ -102,7 +97,7 @@ void SporHost::HandleMessage(const FreertosQueueSendMessage &msg) {
     case QueueType::BASE:
     default:
         profiler::PerfettoApi::LockableRelease(msg.handle);
-        // profiler::PerfettoApi::Plot("Queue Depth", static_cast<int64_t>(msg.updatedCount));
+        profiler::PerfettoApi::Plot("Queue Depth", static_cast<int64_t>(msg.updatedCount), msg.handle);
         break;
     }
 }
@@ -118,7 +113,7 @@ void SporHost::HandleMessage(const FreertosQueueReceiveMessage &msg) {
         break;
     case QueueType::COUNTING_SEMAPHORE:
         profiler::PerfettoApi::LockableObtain(msg.handle);
-        profiler::PerfettoApi::Plot("CountingSem Count", static_cast<int64_t>(msg.updatedCount));
+        profiler::PerfettoApi::Plot("CountingSem Count", static_cast<int64_t>(msg.updatedCount), msg.handle);
         break;
     case QueueType::MUTEX:
     case QueueType::RECURSIVE_MUTEX:
@@ -126,7 +121,7 @@ void SporHost::HandleMessage(const FreertosQueueReceiveMessage &msg) {
         break;
     case QueueType::BASE:
     default:
-        profiler::PerfettoApi::Plot("Queue Depth", static_cast<int64_t>(msg.updatedCount));
+        profiler::PerfettoApi::Plot("Queue Depth", static_cast<int64_t>(msg.updatedCount), msg.handle);
         break;
     }
 }
@@ -134,20 +129,18 @@ void SporHost::HandleMessage(const FreertosQueueReceiveMessage &msg) {
 void SporHost::HandleMessage(const FreertosTaskNotifyMessage &msg) {
     auto it = tasks.find(msg.handle);
     if (it != tasks.end()) {
-        std::string message = "Task " + it->second.name + " notified (index: " + std::to_string(msg.index) +
-                              ", action: " + std::to_string(msg.action) + ")";
-        profiler::PerfettoApi::Message(message);
-        profiler::PerfettoApi::Plot("Task Notify Value", static_cast<int64_t>(msg.updatedValue));
+        profiler::PerfettoApi::Message(
+            "Task " + it->second.name + " notified", {{"index", msg.index}, {"action", msg.action}}
+        );
+        profiler::PerfettoApi::Plot("Task Notify Value", static_cast<int64_t>(msg.updatedValue), msg.handle);
     }
 }
 
 void SporHost::HandleMessage(const FreertosTaskNotifyReceivedMessage &msg) {
     auto it = tasks.find(msg.handle);
     if (it != tasks.end()) {
-        std::string message =
-            "Task " + it->second.name + " notification received (index: " + std::to_string(msg.index) + ")";
-        profiler::PerfettoApi::Message(message);
-        profiler::PerfettoApi::Plot("Task Notify Value", static_cast<int64_t>(msg.updatedValue));
+        profiler::PerfettoApi::Message("Task " + it->second.name + " notification received", {{"index", msg.index}});
+        profiler::PerfettoApi::Plot("Task Notify Value", static_cast<int64_t>(msg.updatedValue), msg.handle);
     }
 }
 
@@ -163,10 +156,10 @@ void SporHost::HandleMessage(const FreertosTaskDeletedMessage &msg) {
 void SporHost::HandleMessage(const FreertosTaskPrioritySetMessage &msg) {
     auto it = tasks.find(msg.handle);
     if (it != tasks.end()) {
-        std::string message = "Task " + it->second.name + " priority changed from " + std::to_string(msg.oldPriority) +
-                              " to " + std::to_string(msg.newPriority);
-        profiler::PerfettoApi::Message(message);
-        profiler::PerfettoApi::Plot("Task Priority", static_cast<int64_t>(msg.newPriority));
+        profiler::PerfettoApi::Message(
+            "Task " + it->second.name + " priority changed", {{"from", msg.oldPriority}, {"to", msg.newPriority}}
+        );
+        profiler::PerfettoApi::Plot("Task Priority", static_cast<int64_t>(msg.newPriority), msg.handle);
     }
 }
 
@@ -191,89 +184,75 @@ void SporHost::HandleMessage(const FreertosTaskResumeMessage &msg) {
 }
 
 void SporHost::HandleMessage(const FreertosTaskDelayMessage &msg) {
-    profiler::ThreadState delayedState{
-        profiler::ThreadState::State::TASK_DELAYED, "Delayed for " + std::to_string(msg.ticksToDelay) + " ticks"
-    };
+    /* The tick count is only in the debug event, a slice name per delay would be interned for every value */
+    profiler::ThreadState delayedState{profiler::ThreadState::State::TASK_DELAYED, "Delayed"};
     profiler::PerfettoApi::UpdateThreadStatus(msg.handle, delayedState);
-    profiler::PerfettoApi::Message("Task delayed for " + std::to_string(msg.ticksToDelay) + " ticks");
+    profiler::PerfettoApi::Message("Task delayed", {{"ticks", msg.ticksToDelay}});
 }
 
 void SporHost::HandleMessage(const FreertosTaskDelayUntilMessage &msg) {
-    profiler::ThreadState delayedState{
-        profiler::ThreadState::State::TASK_DELAYED, "Delayed until tick " + std::to_string(msg.timeToWake)
-    };
+    /* The wake tick differs every time, so it is only in the debug event and not in the slice name */
+    profiler::ThreadState delayedState{profiler::ThreadState::State::TASK_DELAYED, "Delayed until tick"};
     profiler::PerfettoApi::UpdateThreadStatus(msg.handle, delayedState);
-    profiler::PerfettoApi::Message("Task delayed until tick " + std::to_string(msg.timeToWake));
+    profiler::PerfettoApi::Message("Task delayed until tick", {{"tick", msg.timeToWake}});
 }
 
 void SporHost::HandleMessage(const FreertosTimerCreatedMessage &msg) {
-    std::string message = "Timer created (handle: " + std::to_string(msg.handle) +
-                          ", period: " + std::to_string(msg.period) +
-                          ", auto-reload: " + (msg.autoReload ? "yes" : "no") + ")";
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        "Timer created", {{"handle", msg.handle}, {"period", msg.period}, {"auto-reload", msg.autoReload}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosTimerCommandMessage &msg) {
-    std::string message =
-        "Timer command (handle: " + std::to_string(msg.handle) + ", cmd: " + std::to_string(msg.commandId) + ")";
-    if (msg.optionalValue != 0) {
-        message += " value: " + std::to_string(msg.optionalValue);
-    }
-    if (msg.isFromISR) {
-        message += " (from ISR)";
-    }
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        msg.isFromISR ? "Timer command (from ISR)" : "Timer command",
+        {{"handle", msg.handle}, {"cmd", msg.commandId}, {"value", msg.optionalValue}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosTimerExpiredMessage &msg) {
-    std::string message = "Timer expired (handle: " + std::to_string(msg.handle) + ")";
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message("Timer expired", {{"handle", msg.handle}});
 }
 
 void SporHost::HandleMessage(const FreertosEventGroupCreatedMessage &msg) {
-    std::string message = "Event group created (handle: " + std::to_string(msg.handle) + ")";
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message("Event group created", {{"handle", msg.handle}});
     profiler::PerfettoApi::LockableCreate(msg.handle, "EventGroup", "EventGroup");
 }
 
 void SporHost::HandleMessage(const FreertosEventGroupDeletedMessage &msg) {
-    std::string message = "Event group deleted (handle: " + std::to_string(msg.handle) + ")";
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message("Event group deleted", {{"handle", msg.handle}});
 }
 
 void SporHost::HandleMessage(const FreertosEventGroupSyncMessage &msg) {
-    std::string message = "Event group sync (handle: " + std::to_string(msg.handle) + ", set: 0x" +
-                          std::to_string(msg.setBits) + ", wait: 0x" + std::to_string(msg.waitBits) + ")";
-    profiler::PerfettoApi::Message(message);
-    profiler::PerfettoApi::Plot("EventGroup Bits", static_cast<int64_t>(msg.resultBits));
+    profiler::PerfettoApi::Message(
+        "Event group sync", {{"handle", msg.handle}, {"set", msg.setBits}, {"wait", msg.waitBits}}
+    );
+    profiler::PerfettoApi::Plot("EventGroup Bits", static_cast<int64_t>(msg.resultBits), msg.handle);
 }
 
 void SporHost::HandleMessage(const FreertosEventGroupWaitBitsMessage &msg) {
-    std::string message = "Event group wait bits (handle: " + std::to_string(msg.handle) + ", wait: 0x" +
-                          std::to_string(msg.waitBits) + ")";
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message("Event group wait bits", {{"handle", msg.handle}, {"wait", msg.waitBits}});
     profiler::PerfettoApi::LockableWait(msg.handle);
     profiler::PerfettoApi::LockableObtain(msg.handle);
-    profiler::PerfettoApi::Plot("EventGroup Bits", static_cast<int64_t>(msg.resultBits));
+    profiler::PerfettoApi::Plot("EventGroup Bits", static_cast<int64_t>(msg.resultBits), msg.handle);
 }
 
 void SporHost::HandleMessage(const FreertosEventGroupClearBitsMessage &msg) {
-    std::string message = "Event group clear bits (handle: " + std::to_string(msg.handle) + ", clear: 0x" +
-                          std::to_string(msg.clearBits) + ")";
-    if (msg.isFromISR) {
-        message += " (from ISR)";
-    }
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        msg.isFromISR ? "Event group clear bits (from ISR)" : "Event group clear bits",
+        {{"handle", msg.handle}, {"clear", msg.clearBits}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosEventGroupSetBitsMessage &msg) {
-    std::string message =
-        "Event group set bits (handle: " + std::to_string(msg.handle) + ", set: 0x" + std::to_string(msg.setBits) + ")";
-    // TODO
-    // if (msg.isFromISR) {
-    //     message += " (from ISR)";
-    // }
-    profiler::PerfettoApi::Message(message);
+    if (msg.isFromISR) {
+        /* FreeRTOS defers the set to the timer task, which reports it again when the bits are actually set */
+        profiler::PerfettoApi::Message(
+            "Event group set bits (from ISR)", {{"handle", msg.handle}, {"set", msg.setBits}}
+        );
+        return;
+    }
+    profiler::PerfettoApi::Message("Event group set bits", {{"handle", msg.handle}, {"set", msg.setBits}});
     profiler::PerfettoApi::LockableRelease(msg.handle);
 }
 
@@ -367,28 +346,21 @@ void SporHost::HandleMessage(const FreertosQueueCreateFailedMessage &msg) {
 }
 
 void SporHost::HandleMessage(const FreertosQueueSendFailedMessage &msg) {
-    std::string message = "Queue send failed (handle: " + std::to_string(msg.handle) +
-                          ")"; //", type: " + std::to_string(msg.queueType) + ")";
-    if (msg.isFromISR) {
-        message += " (from ISR)";
-    }
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        msg.isFromISR ? "Queue send failed (from ISR)" : "Queue send failed", {{"handle", msg.handle}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosQueueReceiveFailedMessage &msg) {
-    std::string message = "Queue receive failed (handle: " + std::to_string(msg.handle) + ")";
-    if (msg.isFromISR) {
-        message += " (from ISR)";
-    }
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        msg.isFromISR ? "Queue receive failed (from ISR)" : "Queue receive failed", {{"handle", msg.handle}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosQueuePeekFailedMessage &msg) {
-    std::string message = "Queue peek failed (handle: " + std::to_string(msg.handle) + ")";
-    if (msg.isFromISR) {
-        message += " (from ISR)";
-    }
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        msg.isFromISR ? "Queue peek failed (from ISR)" : "Queue peek failed", {{"handle", msg.handle}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosTimerCreateFailedMessage &msg) {
@@ -397,12 +369,9 @@ void SporHost::HandleMessage(const FreertosTimerCreateFailedMessage &msg) {
 }
 
 void SporHost::HandleMessage(const FreertosTimerCommandReceivedMessage &msg) {
-    std::string message = "Timer command received (handle: " + std::to_string(msg.handle) +
-                          ", cmd: " + std::to_string(msg.commandId) + ")";
-    if (msg.optionalValue != 0) {
-        message += " value: " + std::to_string(msg.optionalValue);
-    }
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        "Timer command received", {{"handle", msg.handle}, {"cmd", msg.commandId}, {"value", msg.optionalValue}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosStreamBufferCreateFailedMessage &msg) {
@@ -411,19 +380,16 @@ void SporHost::HandleMessage(const FreertosStreamBufferCreateFailedMessage &msg)
 }
 
 void SporHost::HandleMessage(const FreertosStreamBufferSendFailedMessage &msg) {
-    std::string message = "Stream buffer send failed (handle: " + std::to_string(msg.handle) + ")";
-    if (msg.isFromISR) {
-        message += " (from ISR)";
-    }
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        msg.isFromISR ? "Stream buffer send failed (from ISR)" : "Stream buffer send failed", {{"handle", msg.handle}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosStreamBufferReceiveFailedMessage &msg) {
-    std::string message = "Stream buffer receive failed (handle: " + std::to_string(msg.handle) + ")";
-    if (msg.isFromISR) {
-        message += " (from ISR)";
-    }
-    profiler::PerfettoApi::Message(message);
+    profiler::PerfettoApi::Message(
+        msg.isFromISR ? "Stream buffer receive failed (from ISR)" : "Stream buffer receive failed",
+        {{"handle", msg.handle}}
+    );
 }
 
 void SporHost::HandleMessage(const FreertosEventGroupCreateFailedMessage &msg) {
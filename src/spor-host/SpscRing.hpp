@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <thread>
+#include <type_traits>
+
+/** Spins briefly, then yields, then sleeps, so an idle pipeline stage does not burn a whole core */
+class Backoff {
+public:
+    void Wait() {
+        if (iteration_ < 64) {
+            ++iteration_;
+        } else if (iteration_ < 128) {
+            ++iteration_;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void Reset() {
+        iteration_ = 0;
+    }
+
+private:
+    uint32_t iteration_ = 0;
+};
+
+/**
+ * Bounded lock-free single-producer/single-consumer ring.
+ *
+ * Items are moved in and out in batches, so the shared indices are touched once per batch rather than once per
+ * item. Each side caches the other side's index and only reloads it when the ring looks full or empty. A full
+ * ring makes the producer wait; nothing is ever dropped.
+ */
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : capacity_(std::bit_ceil(capacity)), mask_(capacity_ - 1), slots_(std::make_unique<T[]>(capacity_)) {}
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /** Producer: moves (or copies, for const items) as many items as fit and returns how many were taken */
+    template <typename U>
+    size_t TryPush(std::span<U> items) {
+        static_assert(std::is_same_v<std::remove_const_t<U>, T>);
+
+        const size_t head = producer_.head.load(std::memory_order_relaxed);
+        size_t free = capacity_ - (head - producer_.cachedTail);
+        if (free < items.size()) {
+            producer_.cachedTail = consumer_.tail.load(std::memory_order_acquire);
+            free = capacity_ - (head - producer_.cachedTail);
+        }
+
+        const size_t count = std::min(free, items.size());
+        const size_t index = head & mask_;
+        const size_t first = std::min(count, capacity_ - index);
+        Transfer(items.first(first), slots_.get() + index);
+        Transfer(items.subspan(first, count - first), slots_.get());
+
+        producer_.head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /** Producer: pushes all items, waiting for the consumer while the ring is full */
+    template <typename U>
+    void Push(std::span<U> items) {
+        Backoff backoff;
+        while (!items.empty()) {
+            const size_t pushed = TryPush(items);
+            items = items.subspan(pushed);
+            if (pushed == 0) {
+                backoff.Wait();
+            } else {
+                backoff.Reset();
+            }
+        }
+    }
+
+    /** Producer: no more items will be pushed */
+    void Close() {
+        closed_.store(true, std::memory_order_release);
+    }
+
+    /** Consumer: moves up to `out.size()` items into `out` and returns how many were taken */
+    size_t TryPop(std::span<T> out) {
+        const size_t tail = consumer_.tail.load(std::memory_order_relaxed);
+        size_t available = consumer_.cachedHead - tail;
+        if (available < out.size()) {
+            consumer_.cachedHead = producer_.head.load(std::memory_order_acquire);
+            available = consumer_.cachedHead - tail;
+        }
+
+        const size_t count = std::min(available, out.size());
+        const size_t index = tail & mask_;
+        const size_t first = std::min(count, capacity_ - index);
+        std::move(slots_.get() + index, slots_.get() + index + first, out.data());
+        std::move(slots_.get(), slots_.get() + (count - first), out.data() + first);
+
+        consumer_.tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /** Consumer: waits for at least one item. Returns 0 once the ring is closed and drained. */
+    size_t Pop(std::span<T> out) {
+        Backoff backoff;
+        while (true) {
+            if (const size_t count = TryPop(out)) {
+                return count;
+            }
+            if (closed_.load(std::memory_order_acquire)) {
+                /* Items pushed before Close() are visible now */
+                return TryPop(out);
+            }
+            backoff.Wait();
+        }
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    template <typename U>
+    static void Transfer(std::span<U> items, T *destination) {
+        if constexpr (std::is_const_v<U>) {
+            std::copy(items.begin(), items.end(), destination);
+        } else {
+            std::move(items.begin(), items.end(), destination);
+        }
+    }
+
+    struct alignas(CACHE_LINE) ProducerState {
+        std::atomic<size_t> head{0};
+        size_t cachedTail = 0;
+    };
+
+    struct alignas(CACHE_LINE) ConsumerState {
+        std::atomic<size_t> tail{0};
+        size_t cachedHead = 0;
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    ProducerState producer_;
+    ConsumerState consumer_;
+    alignas(CACHE_LINE) std::atomic<bool> closed_{false};
+};
@@ -1,4 +1,6 @@
-#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 
@@ -37,42 +39,118 @@ void State::FunctionExit(TargetPointer ptr) {
     }
 }
 
+const std::string &State::StringLiteral(TargetPointer address) {
+    auto [it, inserted] = stringLiterals.try_emplace(address);
+    if (inserted) {
+        /* The resolver reads string literals from .rodata */
+        auto symbolInfo = profiler::GetResolvedSymbolInfo(address);
+        if (!symbolInfo.value.empty()) {
+            it->second = symbolInfo.value;
+        } else if (!symbolInfo.name.empty()) {
+            it->second = symbolInfo.name;
+        } else {
+            std::ostringstream hex;
+            hex << "0x" << std::hex << address;
+            it->second = hex.str();
+        }
+    }
+    return it->second;
+}
+
+std::string_view State::ResolveString(const StringOrSymbol &str) {
+    if (!str.HasData()) {
+        return {};
+    }
+    if (str.IsSymbol()) {
+        return StringLiteral(str.AsSymbol());
+    }
+    /* Interned strings have been replaced by their text before the message is handled */
+    return str.IsString() ? std::string_view(str.AsString()) : std::string_view{};
+}
+
+void State::ZoneBegin(TargetPointer name) {
+    profiler::PerfettoApi::ZoneBegin(StringLiteral(name));
+}
+
+void State::ZoneEnd() {
+    profiler::PerfettoApi::ZoneEnd();
+}
+
+uint64_t State::CyclesToNanoseconds(uint64_t cycles) const {
+    const uint64_t hz = cpuFrequencyHz.load();
+    return cycles / hz * 1000000000 + cycles % hz * 1000000000 / hz;
+}
+
+void State::HandlePcSample(const orbcat::PcSample &sample) {
+    samplingProfiler.AddSample(profiler::PerfettoApi::currentThreadId, sample);
+}
+
+void State::HandleOverflow() {
+    ++dropStats.overflows;
+    profiler::PerfettoApi::DataLost("ITM overflow");
+}
+
+void State::HandleDataLost(uint32_t messages) {
+    ++dropStats.gaps;
+    dropStats.lostMessages += messages;
+    profiler::PerfettoApi::DataLost(
+        messages ? std::to_string(messages) + " messages lost" : std::string("Mis-framed messages")
+    );
+}
+
 void State::HandleException(const orbcat::ExceptionMessage &exception, uint64_t timestamp) {
-    return; // TEMP
-    DeviceInfo::IrqNumber irqNumber = static_cast<DeviceInfo::IrqNumber>(exception.exceptionNumber);
+    using Event = orbcat::ExceptionMessage::ExceptionEvent;
 
-    if (exception.exceptionNumber == 0 && exception.event == orbcat::ExceptionMessage::ExceptionEvent::RESUME) {
-        profiler::PerfettoApi::ExitAllIrqs();
-        return;
+    if (hasItmTimestampOffset) {
+        /* Never before the last message, in case the exception was not re-sequenced to its own timestamp */
+        profiler::PerfettoApi::SetTime(CyclesToNanoseconds(std::max(timestamp + itmTimestampOffset, cycles)));
     }
 
-    // Find the IRQ name from the device info table
-    auto irqIt = deviceInfo.irq_table.find(irqNumber);
-    if (irqIt != deviceInfo.irq_table.end()) {
-        std::string irqName = std::string(irqIt->second);
-        TargetPointer irqPtr = static_cast<TargetPointer>(irqNumber);
-
-        switch (exception.event) {
-        case orbcat::ExceptionMessage::ExceptionEvent::ENTER:
-            std::cout << "     ENTER " << irqName << std::endl;
-
-            profiler::PerfettoApi::EnsureThreadRegistered(irqPtr, irqName.c_str());
-            profiler::PerfettoApi::EnterIrq(irqPtr);
-            break;
-        case orbcat::ExceptionMessage::ExceptionEvent::EXIT:
-            std::cout << "     EXIT " << irqName << std::endl;
-
-            profiler::PerfettoApi::ExitIrq(irqPtr);
-            break;
-        case orbcat::ExceptionMessage::ExceptionEvent::RESUME:
-            std::cout << "     RESUME " << irqName << std::endl;
-            // Todo?
-            break;
-        default:
-            // ??
-            break;
+    /* Exception numbers start with the 16 system exceptions, IRQ numbers at the first external interrupt */
+    const auto irq = static_cast<DeviceInfo::IrqNumber>(static_cast<int>(exception.exceptionNumber) - 16);
+
+    switch (exception.event) {
+    case Event::ENTER:
+        /* After a tail-chained exit there is no current thread, the interrupted task stays the same */
+        if (activeExceptions.empty() && profiler::PerfettoApi::currentThreadId != 0) {
+            interruptedThreadId = profiler::PerfettoApi::currentThreadId;
         }
-    } else {
-        std::cout << "Unknown IRQ number " << irqNumber << ", event: " << (int)exception.event << std::endl;
+        activeExceptions.push_back(irq);
+        profiler::PerfettoApi::EnterIrq(static_cast<uint32_t>(irq));
+        break;
+
+    case Event::EXIT:
+        /* Exceptions that were entered before the capture started are not tracked */
+        if (auto it = std::find(activeExceptions.rbegin(), activeExceptions.rend(), irq);
+            it != activeExceptions.rend()) {
+            activeExceptions.erase(std::next(it).base());
+            profiler::PerfettoApi::ExitIrq(static_cast<uint32_t>(irq));
+        }
+        break;
+
+    case Event::RESUME:
+        if (exception.exceptionNumber == 0) {
+            /* Back in thread mode. Anything still active lost its exit packet. */
+            for (auto active : activeExceptions) {
+                profiler::PerfettoApi::ExitIrq(static_cast<uint32_t>(active));
+            }
+            activeExceptions.clear();
+            /* A task switch in the handler (PendSV) has already made the new task current */
+            if (profiler::PerfettoApi::currentThreadId == 0) {
+                profiler::PerfettoApi::currentThreadId = interruptedThreadId;
+            }
+        } else {
+            while (!activeExceptions.empty() && activeExceptions.back() != irq) {
+                profiler::PerfettoApi::ExitIrq(static_cast<uint32_t>(activeExceptions.back()));
+                activeExceptions.pop_back();
+            }
+            if (!activeExceptions.empty()) {
+                profiler::PerfettoApi::EnterIrq(static_cast<uint32_t>(irq));
+            }
+        }
+        break;
+
+    default:
+        break;
     }
 }
@@ -3,9 +3,12 @@
 #include <atomic>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "HeapTracker.hpp"
 #include "orbcat/Orbcat.hpp"
 #include "PerfettoApi.hpp"
+#include "SamplingProfiler.hpp"
 #include "spor-devices/DeviceInfo.hpp"
 #include "spor-host/Decoder.hpp"
 #include "symbol-resolver/ElfSymbolResolver.hpp"
@@ -60,22 +63,64 @@ inline profiler::ThreadState CreateThreadStateFromSwitchReason(FreeRtosSwitchRea
     }
 }
 
+/** Data lost on the way from the target, over the whole capture */
+struct DropStats {
+    uint64_t overflows = 0;    /* ITM overflow packets */
+    uint64_t gaps = 0;         /* SEQUENCE packets that did not match the decoded messages */
+    uint64_t lostMessages = 0; /* Messages missing according to those */
+};
+
 struct State {
     DeviceInfo deviceInfo = getDeviceInfo();
 
     std::atomic<uint64_t> cpuFrequencyHz{200000000};
 
+    /* DWT->CYCCNT extended to 64 bits, so that time stays monotonic when it wraps around */
+    uint64_t cycles = 0;
+    uint32_t lastCycleCount = 0;
+    bool hasCycleCount = false;
+    /* The target queues messages with SPOR_DEFERRED_TRANSPORT, so cycle counts can step back, see OnCycleCount */
+    bool deferredTransport = false;
+
+    /* Cycle count minus ITM timestamp, renewed with every CYCLE_COUNT, to put hardware packets on the same time
+     * line. Assumes that the ITM timestamp counts CPU cycles (TSPrescale 1). */
+    uint64_t itmTimestampOffset = 0;
+    bool hasItmTimestampOffset = false;
+
     std::unordered_map<TargetPointer, TaskInfo> tasks;
     std::unordered_map<TargetPointer, ObjectInfo> objects;
 
     std::unordered_map<TargetPointer, IrqInfo> irqFunctions;
 
+    /* Exceptions active on the target from the exception trace, innermost last, and the task they interrupted */
+    std::vector<DeviceInfo::IrqNumber> activeExceptions;
+    uint32_t interruptedThreadId = 0;
+
+    /* String literals sent by address, such as zone names, resolved from the ELF file on first use */
+    std::unordered_map<TargetPointer, std::string> stringLiterals;
+
+    SamplingProfiler samplingProfiler;
+    HeapTracker heapTracker;
+    DropStats dropStats;
+
     void SymbolsLoaded();
 
+    uint64_t CyclesToNanoseconds(uint64_t cycles) const;
+
     void FunctionEnter(TargetPointer ptr);
     void FunctionExit(TargetPointer ptr);
 
+    const std::string &StringLiteral(TargetPointer address);
+    /** The text of a string from the target, which is sent either in full or as the address of a literal */
+    std::string_view ResolveString(const StringOrSymbol &str);
+
+    void ZoneBegin(TargetPointer name);
+    void ZoneEnd();
+
     void HandleException(const orbcat::ExceptionMessage &exception, uint64_t timestamp);
+    void HandlePcSample(const orbcat::PcSample &sample);
+    void HandleOverflow();
+    void HandleDataLost(uint32_t messages);
 
     std::unordered_map<uint32_t, std::string> pointerNames;
     std::unordered_map<uint32_t, std::string> pointerTypes;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * Bump allocator for the strings of a batch of decoded events. Reset() keeps the blocks, so once the arena has
+ * grown to the size of a batch, storing strings does not allocate.
+ */
+class StringArena {
+public:
+    std::string_view Store(std::string_view text) {
+        if (text.empty()) {
+            return {};
+        }
+        if (block_ == blocks_.size() || text.size() > blocks_[block_].size - used_) {
+            NextBlock(text.size());
+        }
+
+        char *destination = blocks_[block_].data.get() + used_;
+        std::memcpy(destination, text.data(), text.size());
+        used_ += text.size();
+        return {destination, text.size()};
+    }
+
+    void Reset() {
+        block_ = 0;
+        used_ = 0;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 << 10;
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t block_ = 0;
+    size_t used_ = 0;
+
+    void NextBlock(size_t minimumSize) {
+        if (block_ < blocks_.size()) {
+            ++block_;
+        }
+        /* Skip kept blocks too small for an oversized string */
+        while (block_ < blocks_.size() && blocks_[block_].size < minimumSize) {
+            ++block_;
+        }
+        if (block_ == blocks_.size()) {
+            const size_t size = std::max(BLOCK_SIZE, minimumSize);
+            blocks_.push_back({std::make_unique<char[]>(size), size});
+        }
+        used_ = 0;
+    }
+};
@@ -6,16 +6,64 @@
 #include <thread>
 
 #include "Options.hpp"
-#include "orbcat/Orbcat.hpp"
+#include "orbcat/MappedFile.hpp"
+#include "orbcat/StaticOrbcat.hpp"
+#include "ParallelDecoder.hpp"
 #include "PerfettoApi.hpp"
+#include "Pipeline.hpp"
 #include "SporHost.hpp"
 #include "symbol-resolver/ElfSymbolResolver.hpp"
 
+namespace {
+
+/** Single-threaded path: ITM packets go straight into the message decoder */
+struct HostSink {
+    MessageDecoder &decoder;
+    SporHost &host;
+
+    void OnChannelData(uint8_t channel, uint64_t timestamp, std::span<const std::byte> data) {
+        decoder.ProcessChannelData(channel, timestamp, data);
+    }
+
+    void OnException(const orbcat::ExceptionMessage &exception, uint64_t timestamp) {
+        host.HandleException(exception, timestamp);
+    }
+
+    void OnPcSample(const orbcat::PcSample &sample, uint64_t) {
+        host.HandlePcSample(sample);
+    }
+
+    void OnOverflow(uint64_t) {
+        decoder.OnOverflow();
+        host.HandleOverflow();
+    }
+};
+
+/** `unknownMessages` counts messages of a type this host does not know, usually from a newer target */
+void WriteReports(uint64_t unknownMessages) {
+    const auto &host = SporHost::GetInstance();
+    const auto &drops = host.dropStats;
+    std::cout << "Data lost: " << drops.overflows << " ITM overflows, " << drops.gaps << " sequence gaps ("
+              << drops.lostMessages << " messages)" << std::endl;
+    if (unknownMessages != 0) {
+        std::cout << "Unknown messages skipped: " << unknownMessages << std::endl;
+    }
+
+    if (host.samplingProfiler.HasSamples()) {
+        host.samplingProfiler.WriteReport(std::cout);
+    }
+    if (host.heapTracker.HasAllocations()) {
+        host.heapTracker.WriteReport(std::cout);
+    }
+}
+
+}
+
 int main(int argc, char *argv[]) {
     auto options = Options::parseCommandLine(argc, argv);
 
     try {
-        auto tracing_session = profiler::PerfettoApi::StartTracing();
+        auto tracing_session = profiler::PerfettoApi::StartTracing(options.outputFile);
 
         if (!options.elfFile.empty()) {
             auto symbolResolver = std::make_unique<spor::ElfSymbolResolver>(options.elfFile);
@@ -28,27 +76,48 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        orbcat::MessageHandler handlers;
-        handlers.onChannelData = [](uint8_t channel, uint64_t timestamp, std::span<std::byte> data) {
-            // SporHost::GetInstance().HandleTimestamp(timestamp);
-            MessageDecoder::GetInstance()->ProcessChannelData(channel, timestamp, data);
-        };
-        handlers.onException = [](const orbcat::ExceptionMessage &exception, uint64_t timestamp) {
-            // SporHost::GetInstance().HandleTimestamp(timestamp);
-            SporHost::GetInstance().HandleException(exception, timestamp);
-        };
-        handlers.onTimestamp = [](uint64_t timestamp, orbcat::TimeStatus status) {
-            // profiler::PerfettoApi::SetTime(timestamp);
-            // profiler::PerfettoApi::SetTime(timestamp);
-            // SporHost::GetInstance().HandleTimestamp(timestamp);
-        };
-        orbcat::Orbcat orbcat(options.orbcatOptions, std::move(handlers));
+        SporHost::GetInstance().deferredTransport = options.deferredTransport;
+
+        auto &samplingProfiler = SporHost::GetInstance().samplingProfiler;
+        if (!options.samplesFile.empty() && !samplingProfiler.OpenPerfScript(options.samplesFile)) {
+            std::cerr << "Failed to open samples file: " << options.samplesFile << std::endl;
+        }
+
+        const auto &orbcatOptions = options.orbcatOptions;
+        if (!orbcatOptions.inputFile.empty() && orbcatOptions.mapInputFile && orbcatOptions.endTerminate &&
+            options.decodeThreads > 1) {
+            orbcat::MappedFile capture(orbcatOptions.inputFile);
+            if (capture.IsOpen()) {
+                ParallelDecoder decoder(
+                    capture.Data(), SporHost::GetInstance(), options.decodeThreads,
+                    orbcat::IsTargetTimestampMode(orbcatOptions.timestampMode)
+                );
+                decoder.Run();
+
+                profiler::PerfettoApi::StopTracing(std::move(tracing_session));
+                WriteReports(decoder.UnknownMessageCount());
+                return 0;
+            }
+        }
+
+        if (options.pipeline) {
+            Pipeline pipeline(options.orbcatOptions, SporHost::GetInstance());
+            pipeline.Run();
+
+            profiler::PerfettoApi::StopTracing(std::move(tracing_session));
+            WriteReports(pipeline.UnknownMessageCount());
+            return 0;
+        }
+
+        HostSink sink{*MessageDecoder::GetInstance(), SporHost::GetInstance()};
+        orbcat::StaticOrbcat<HostSink> orbcat(options.orbcatOptions, sink);
         std::thread orbThread([&orbcat]() {
             orbcat.Start();
         });
         orbThread.join();
 
         profiler::PerfettoApi::StopTracing(std::move(tracing_session));
+        WriteReports(sink.decoder.UnknownMessageCount());
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
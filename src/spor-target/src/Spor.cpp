@@ -1,5 +1,6 @@
 #include "Spor.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "spor-common/Messages.hpp"
@@ -7,7 +8,25 @@
 
 using namespace spor;
 
+namespace {
+/**
+ * Zones go on Channel::ZONE, unless the name does not fit next to the end flag. With the deferred transport they
+ * stay messages, so they are not written out ahead of the task switches queued before them.
+ */
+bool SendOnZoneChannel(uint32_t name) {
+#ifdef SPOR_DEFERRED_TRANSPORT
+    return false;
+#else
+    return (name & ZONE_END_FLAG) == 0 && IsEventEnabled(EventCategory::ZONE) && Transport::isReady();
+#endif
+}
+}
+
 void TraceZoneBegin(const char *name) {
+    if (SendOnZoneChannel((uint32_t)name)) {
+        SendZoneEvent((uint32_t)name, false);
+        return;
+    }
     Send(
         ZoneBeginData{
             .ptr = (uint32_t)name,
@@ -16,6 +35,10 @@ void TraceZoneBegin(const char *name) {
 }
 
 void TraceZoneEnd(const char *name) {
+    if (SendOnZoneChannel((uint32_t)name)) {
+        SendZoneEvent((uint32_t)name, true);
+        return;
+    }
     Send(
         ZoneEndData{
             .ptr = (uint32_t)name,
@@ -124,6 +147,43 @@ void TraceFlowEnd(const void *ptr) {
     Send(FlowEndMessage{static_cast<TargetPointer>(reinterpret_cast<uintptr_t>(ptr))});
 }
 
+uint32_t SporDrain() {
+#ifdef SPOR_DEFERRED_TRANSPORT
+    return static_cast<uint32_t>(DeferredDrain());
+#else
+    return 0;
+#endif
+}
+
+uint32_t SporDroppedMessages() {
+#ifdef SPOR_DEFERRED_TRANSPORT
+    return DeferredOverflows();
+#else
+    return 0;
+#endif
+}
+
+void SporStartPcSampling(uint32_t interval_cycles) {
+    /* A sample is taken every POSTPRESET + 1 taps of the cycle counter, with a tap every 64 or 1024 cycles */
+    const bool slowTap = interval_cycles > 16 * 64;
+    const uint32_t tapCycles = slowTap ? 1024 : 64;
+    const uint32_t reload = std::clamp<uint32_t>(interval_cycles / tapCycles, 1, 16) - 1;
+
+    /* The sample rate can only be changed while sampling is off */
+    SporStopPcSampling();
+    ITM->TCR |= ITM_TCR_DWTENA_Msk;
+
+    uint32_t ctrl = DWT->CTRL & ~(DWT_CTRL_CYCTAP_Msk | DWT_CTRL_POSTPRESET_Msk | DWT_CTRL_POSTINIT_Msk);
+    ctrl |= (slowTap ? DWT_CTRL_CYCTAP_Msk : 0) | (reload << DWT_CTRL_POSTPRESET_Pos) |
+            (reload << DWT_CTRL_POSTINIT_Pos) | DWT_CTRL_CYCCNTENA_Msk;
+    DWT->CTRL = ctrl;
+    DWT->CTRL = ctrl | DWT_CTRL_PCSAMPLENA_Msk;
+}
+
+void SporStopPcSampling() {
+    DWT->CTRL &= ~DWT_CTRL_PCSAMPLENA_Msk;
+}
+
 #ifdef __cplusplus
 void TraceDeclareType(const void *ptr, const std::type_info *typeInfo) {
     Send(
@@ -18,6 +18,21 @@ void TraceInterruptEnter(uint16_t irq_number, uint32_t enabled_flags);
 void TraceInterruptExit(uint16_t irq_number);
 void TraceFlowBegin(const void *ptr);
 void TraceFlowEnd(const void *ptr);
+
+/* With SPOR_DEFERRED_TRANSPORT, writes queued messages to the ITM. Call it from the idle task or another
+ * low-priority context; it does nothing otherwise. Returns the number of messages sent. */
+uint32_t SporDrain(void);
+/* Messages dropped by SPOR_DEFERRED_TRANSPORT because a ring was full */
+uint32_t SporDroppedMessages(void);
+
+/* Makes the DWT send the sampled PC about every `interval_cycles` cycles (64 to 16384, rounded down to what the
+ * DWT supports). The samples are hardware ITM packets, the firmware does no work per sample. */
+void SporStartPcSampling(uint32_t interval_cycles);
+void SporStopPcSampling(void);
+
+/* Bitmask of the event categories that are sent (see spor-common/EventCategory.hpp). Defaults to spor_EVENT_MASK
+ * and can be changed at any time, also by a debugger. */
+extern volatile uint32_t spor_event_mask;
 #ifdef __cplusplus
 }
 #endif
@@ -6,6 +6,8 @@
 #include "transport/Transport.hpp"
 
 extern "C" int _write(int fd, char *ptr, int len) {
+    if (!spor::IsEventEnabled(EventCategory::CONSOLE))
+        return len;
     spor::SendCycleCount();
     ITMWriteBuffer(static_cast<uint8_t>(Channel::CONSOLE_LOG), ptr, len);
     return len;
@@ -2,6 +2,7 @@
 #include SPOR_SYSTEM_HEADER
 #include "queue.h"
 #include "spor-common/Messages.hpp"
+#include "Spor.h"
 #include "task.h"
 #include "transport/Transport.hpp"
 #include "Utils.hpp"
@@ -119,7 +120,10 @@ void SporFreeRtosIncreaseTick() {}
 
 void SporFreeRtosTaskIncrementTick(int wasSwitch) {}
 
-void SporFreeRtosLowPowerIdleBegin() {}
+void SporFreeRtosLowPowerIdleBegin() {
+    /* Empty the deferred rings before sleeping */
+    SporDrain();
+}
 
 void SporFreeRtosLowPowerIdleEnd() {}
 
@@ -467,13 +471,16 @@ void SporFreeRtosPendFuncCall(void *function, void *param1, uint32_t param2, uin
 void SporFreeRtosPendFuncCallFromISR(void *function, void *param1, uint32_t param2, uint32_t returnValue) {}
 
 void SporFreeRtosMalloc(void *ptr, size_t size) {
-    Send(
-        AllocData{.ptr = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr)), .size = static_cast<uint32_t>(size)}
-    );
+    /* Sent for failed allocations too, with a null pointer */
+    Send(AllocMessage{
+        {.ptr = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr)), .size = static_cast<uint32_t>(size)}, {}
+    });
 }
 
 void SporFreeRtosFree(void *ptr) {
-    Send(FreeData{.ptr = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr))});
+    if (!ptr)
+        return;
+    Send(FreeMessage{{.ptr = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr))}, {}});
 }
 
 void SporFreeRtosEventGroupCreate(void *eventGroup) {
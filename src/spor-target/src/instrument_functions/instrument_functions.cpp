@@ -19,16 +19,28 @@ void ITMWrite32_assume_enabled(uint8_t port, uint32_t value) {
 
 extern "C" __attribute__((no_instrument_function, noinline)) void
 __cyg_profile_func_enter(void *this_fn, void *call_site) {
-    if (isInInterrupt())
+    if (isInInterrupt() || !IsEventEnabled(EventCategory::FUNCTION))
         return;
+#ifdef SPOR_COMPACT_RECORDS
+    SendFunctionEvent(reinterpret_cast<uint32_t>(this_fn), false);
+#else
+    const IrqLockGuard lock{};
     SendCycleCount();
     ITMWrite32_assume_enabled(static_cast<uint8_t>(Channel::FUNCTION_ENTER), reinterpret_cast<uint32_t>(this_fn));
+    SendSequenceIfDue();
+#endif
 }
 
 extern "C" __attribute__((no_instrument_function, noinline)) void
 __cyg_profile_func_exit(void *this_fn, void *call_site) {
-    if (isInInterrupt())
+    if (isInInterrupt() || !IsEventEnabled(EventCategory::FUNCTION))
         return;
+#ifdef SPOR_COMPACT_RECORDS
+    SendFunctionEvent(reinterpret_cast<uint32_t>(this_fn), true);
+#else
+    const IrqLockGuard lock{};
     SendCycleCount();
     ITMWrite32_assume_enabled(static_cast<uint8_t>(Channel::FUNCTION_EXIT), reinterpret_cast<uint32_t>(this_fn));
+    SendSequenceIfDue();
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+#ifdef SPOR_DEFERRED_TRANSPORT
+
+#include "DeferredTransport.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#include "Transport.hpp"
+
+namespace spor {
+
+namespace {
+
+static_assert(
+    spor_DEFERRED_RING_SIZE >= 64 && (spor_DEFERRED_RING_SIZE & (spor_DEFERRED_RING_SIZE - 1)) == 0,
+    "spor_DEFERRED_RING_SIZE must be a power of two of at least 64 bytes"
+);
+static_assert(spor_DEFERRED_RING_COUNT >= 1);
+
+constexpr uint32_t RING_WORDS = spor_DEFERRED_RING_SIZE / sizeof(uint32_t);
+
+/* A record is a header word, the cycle count and the payload padded to whole words */
+constexpr uint32_t HEADER_WORDS = 2;
+static_assert(
+    HEADER_WORDS + (spor_BUFFER_SIZE + 3) / 4 <= RING_WORDS / 2,
+    "spor_DEFERRED_RING_SIZE is too small for spor_BUFFER_SIZE"
+);
+
+/* Header word: [COMMITTED:8][type:8][length:16]. Free space is zero, so a reserved record that is still being
+ * written has no COMMITTED marker yet. Padding records fill the end of the ring, their length is in words. */
+constexpr uint32_t COMMITTED = 0xA5;
+constexpr uint8_t PADDING = 0xFF;
+
+struct Ring {
+    std::atomic<uint32_t> head{0}; /* Words reserved by writers */
+    std::atomic<uint32_t> tail{0}; /* Words released by the drain */
+    std::atomic<uint32_t> overflows{0};
+    uint32_t words[RING_WORDS]{};
+};
+
+Ring rings[spor_DEFERRED_RING_COUNT];
+
+constexpr uint32_t MakeHeader(uint8_t type, uint32_t length) {
+    return COMMITTED << 24 | static_cast<uint32_t>(type) << 16 | length;
+}
+
+NO_INSTRUMENT uint32_t LoadHeader(uint32_t &word) {
+    return std::atomic_ref<uint32_t>(word).load(std::memory_order_acquire);
+}
+
+NO_INSTRUMENT void PublishHeader(uint32_t &word, uint32_t header) {
+    std::atomic_ref<uint32_t>(word).store(header, std::memory_order_release);
+}
+
+/**
+ * Thread mode uses the first ring, exceptions are spread over the others by priority, the most urgent last. A
+ * writer can only be preempted by a more urgent one, so writers rarely contend for the same ring.
+ */
+NO_INSTRUMENT Ring &CurrentRing() {
+    if constexpr (spor_DEFERRED_RING_COUNT == 1) {
+        return rings[0];
+    }
+
+    const uint32_t exception = __get_IPSR() & 0x1FF;
+    if (exception == 0) {
+        return rings[0];
+    }
+    /* NMI and HardFault have fixed negative priorities */
+    if (exception < 4) {
+        return rings[spor_DEFERRED_RING_COUNT - 1];
+    }
+
+    constexpr uint32_t LEVELS = 1U << __NVIC_PRIO_BITS;
+    const uint32_t priority = NVIC_GetPriority(static_cast<IRQn_Type>(static_cast<int32_t>(exception) - 16));
+    return rings[1 + (LEVELS - 1 - priority) * (spor_DEFERRED_RING_COUNT - 1) / LEVELS];
+}
+
+/** Zeroes a consumed record so its words read as free space again, then hands them back to the writers */
+NO_INSTRUMENT void Release(Ring &ring, uint32_t tail, uint32_t words) {
+    std::memset(&ring.words[tail & (RING_WORDS - 1)], 0, words * sizeof(uint32_t));
+    ring.tail.store(tail + words, std::memory_order_release);
+}
+
+/** Skips padding at the tail. Returns false when the ring is empty or its oldest record is not written yet. */
+NO_INSTRUMENT bool PeekRecord(Ring &ring, uint32_t &header) {
+    while (true) {
+        const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+        if (tail == ring.head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        header = LoadHeader(ring.words[tail & (RING_WORDS - 1)]);
+        if (header >> 24 != COMMITTED) {
+            return false;
+        }
+        if (static_cast<uint8_t>(header >> 16) != PADDING) {
+            return true;
+        }
+        Release(ring, tail, header & 0xFFFF);
+    }
+}
+
+}
+
+bool DeferredWrite(uint8_t messageTypeIndex, uint32_t cycles, std::span<const std::byte> payload) {
+    Ring &ring = CurrentRing();
+    const uint32_t words = HEADER_WORDS + (payload.size() + 3) / 4;
+
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    uint32_t index;
+    uint32_t padding;
+    do {
+        index = head & (RING_WORDS - 1);
+        padding = RING_WORDS - index < words ? RING_WORDS - index : 0;
+        if (head + padding + words - ring.tail.load(std::memory_order_acquire) > RING_WORDS) {
+            ring.overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!ring.head.compare_exchange_weak(head, head + padding + words, std::memory_order_relaxed));
+
+    if (padding) {
+        PublishHeader(ring.words[index], MakeHeader(PADDING, padding));
+        index = 0;
+    }
+    ring.words[index + 1] = cycles;
+    std::memcpy(&ring.words[index + HEADER_WORDS], payload.data(), payload.size());
+    PublishHeader(ring.words[index], MakeHeader(messageTypeIndex, payload.size()));
+    return true;
+}
+
+size_t DeferredDrain() {
+    size_t sent = 0;
+
+    while (true) {
+        Ring *oldest = nullptr;
+        uint32_t oldestHeader = 0;
+        uint32_t oldestCycles = 0;
+
+        for (auto &ring : rings) {
+            uint32_t header;
+            if (!PeekRecord(ring, header)) {
+                /* A record still being written may be older than the others, so wait for it */
+                if (ring.tail.load(std::memory_order_relaxed) != ring.head.load(std::memory_order_acquire)) {
+                    return sent;
+                }
+                continue;
+            }
+
+            const uint32_t cycles = ring.words[(ring.tail.load(std::memory_order_relaxed) + 1) & (RING_WORDS - 1)];
+            if (!oldest || static_cast<int32_t>(cycles - oldestCycles) < 0) {
+                oldest = &ring;
+                oldestHeader = header;
+                oldestCycles = cycles;
+            }
+        }
+        if (!oldest) {
+            return sent;
+        }
+
+        const uint32_t tail = oldest->tail.load(std::memory_order_relaxed);
+        const uint32_t length = oldestHeader & 0xFFFF;
+        const auto *payload = reinterpret_cast<const std::byte *>(&oldest->words[(tail & (RING_WORDS - 1)) + HEADER_WORDS]);
+
+#ifdef SPOR_COMPACT_RECORDS
+        SendRecord(static_cast<uint8_t>(oldestHeader >> 16), oldestCycles, {payload, length});
+#else
+        {
+            /* Function instrumentation still writes directly, keep it out of the message */
+            const IrqLockGuard lock{};
+            ITMWrite32(static_cast<uint8_t>(Channel::CYCLE_COUNT), oldestCycles);
+            SendMessageHeader(static_cast<uint8_t>(oldestHeader >> 16), length);
+            SendChannel(Channel::MESSAGE_DATA, {payload, length});
+            SendSequenceIfDue();
+        }
+#endif
+
+        Release(*oldest, tail, HEADER_WORDS + (length + 3) / 4);
+        ++sent;
+    }
+}
+
+uint32_t DeferredOverflows() {
+    uint32_t overflows = 0;
+    for (const auto &ring : rings) {
+        overflows += ring.overflows.load(std::memory_order_relaxed);
+    }
+    return overflows;
+}
+
+}
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "Utils.hpp"
+
+#ifndef spor_DEFERRED_RING_SIZE
+#define spor_DEFERRED_RING_SIZE 1024
+#endif
+
+#ifndef spor_DEFERRED_RING_COUNT
+#define spor_DEFERRED_RING_COUNT 4
+#endif
+
+namespace spor {
+
+/**
+ * Queues a serialized message in the RAM ring of the current execution context instead of writing it to the
+ * ITM. Space is reserved with a compare-and-swap, so interrupts stay enabled. Returns false and counts an
+ * overflow when the ring is full.
+ */
+bool NO_INSTRUMENT DeferredWrite(uint8_t messageTypeIndex, uint32_t cycles, std::span<const std::byte> payload);
+
+/**
+ * Writes queued messages to the ITM, oldest cycle count first across the rings. Must only be called from one
+ * context at a time, usually the idle task. Returns the number of messages sent.
+ */
+size_t NO_INSTRUMENT DeferredDrain();
+
+/** Messages dropped because their ring was full */
+uint32_t NO_INSTRUMENT DeferredOverflows();
+
+}
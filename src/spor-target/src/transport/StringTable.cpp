@@ -0,0 +1,75 @@
+#include <cstdint>
+#include <cstring>
+
+#include "IrqLockGuard.hpp"
+#include "spor-common/utils/String.hpp"
+#include "Utils.hpp"
+
+/* Number of RAM strings that are remembered, 0 sends them in full every time */
+#ifndef spor_STRING_TABLE_SIZE
+#define spor_STRING_TABLE_SIZE 32
+#endif
+
+namespace spor {
+
+#if spor_STRING_TABLE_SIZE > 0
+namespace {
+
+static_assert(spor_STRING_TABLE_SIZE <= UINT16_MAX + 1);
+
+/* The text is sent again after this many uses, so the host recovers from a lost definition */
+constexpr uint8_t STRING_REFRESH_INTERVAL = UINT8_MAX;
+
+/* A slot only remembers a hash of the text, as the string itself may be changed or freed after it was sent */
+struct Slot {
+    uint32_t hash;
+    uint16_t length;
+    uint8_t uses;
+};
+
+/* Direct mapped by hash, a string that lands on a used slot replaces the one there */
+Slot slots[spor_STRING_TABLE_SIZE]{};
+
+/** FNV-1a */
+uint32_t NO_INSTRUMENT Hash(const char *str, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(str[i])) * 16777619u;
+    }
+    return hash;
+}
+
+}
+
+bool NO_INSTRUMENT InternString(const char *str, uint16_t &id, bool &define) {
+    const size_t length = std::strlen(str);
+    if (length == 0 || length > UINT16_MAX) {
+        return false;
+    }
+    const uint32_t hash = Hash(str, length);
+    id = static_cast<uint16_t>(hash % spor_STRING_TABLE_SIZE);
+
+    const IrqLockGuard lock{};
+    auto &slot = slots[id];
+    if (slot.length == length && slot.hash == hash && ++slot.uses < STRING_REFRESH_INTERVAL) {
+        define = false;
+        return true;
+    }
+    slot = {hash, static_cast<uint16_t>(length), 0};
+    define = true;
+    return true;
+}
+
+void NO_INSTRUMENT ForgetString(uint16_t id) {
+    const IrqLockGuard lock{};
+    slots[id] = {};
+}
+#else
+bool InternString(const char *, uint16_t &, bool &) {
+    return false;
+}
+
+void ForgetString(uint16_t) {}
+#endif
+
+}
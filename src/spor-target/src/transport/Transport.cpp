@@ -1,7 +1,11 @@
 #include "Transport.hpp"
 
+#include <cstring>
+
 #include "spor-common/Messages.hpp"
 
+volatile uint32_t spor_event_mask = spor_EVENT_MASK;
+
 namespace spor {
 
 bool Transport::isReady() {
@@ -14,4 +18,132 @@ void NO_INSTRUMENT SendChannel(Channel channel, std::span<const std::byte> data)
     ITMWriteBuffer(static_cast<uint8_t>(channel), data.data(), data.size());
 }
 
+namespace {
+/* Messages sent so far, modulo 2^16. Only changed with interrupts locked. */
+uint16_t messagesSent = 0;
+
+/** A single ITM write of 1, 2 or 4 bytes */
+void NO_INSTRUMENT WritePort(Channel channel, uint32_t value, size_t size) {
+    const auto port = static_cast<uint8_t>(channel);
+    if (!ITMIsPortEnabled(port))
+        return;
+
+    while (ITM->PORT[port].u32 == 0UL) {
+        __NOP();
+    }
+    if (size == 1) {
+        ITM->PORT[port].u8 = static_cast<uint8_t>(value);
+    } else if (size == 2) {
+        ITM->PORT[port].u16 = static_cast<uint16_t>(value);
+    } else {
+        ITM->PORT[port].u32 = value;
+    }
+}
+}
+
+void NO_INSTRUMENT SendSequenceIfDue() {
+    if (++messagesSent % SEQUENCE_INTERVAL == 0) {
+        WritePort(Channel::SEQUENCE, messagesSent, 2);
+    }
+}
+
+void NO_INSTRUMENT SendZoneEvent(uint32_t name, bool end) {
+    const IrqLockGuard lock{};
+    SendCycleCount();
+    WritePort(Channel::ZONE, end ? name | ZONE_END_FLAG : name, 4);
+    SendSequenceIfDue();
+}
+
+#ifdef SPOR_COMPACT_RECORDS
+namespace {
+/* Timestamp that the next record or CYCLE_DELTA is relative to. Only changed with interrupts locked. */
+uint32_t cycleBase = 0;
+/* Starts at the interval, so the first timestamp is sent as an absolute cycle count */
+uint32_t eventsSinceAnchor = RECORD_ANCHOR_INTERVAL;
+/* Function address that the next FUNCTION_EVENT is relative to */
+uint32_t functionBase = 0;
+uint32_t functionsSinceAddress = RECORD_ANCHOR_INTERVAL;
+
+/** Sends an absolute CYCLE_COUNT if it is time for one, or if the delta to `cycles` would not fit in CYCLE_DELTA */
+bool NO_INSTRUMENT SendCycleAnchorIfDue(uint32_t cycles) {
+    if (++eventsSinceAnchor < RECORD_ANCHOR_INTERVAL && cycles - cycleBase < CYCLE_DELTA_LIMIT) {
+        return false;
+    }
+    eventsSinceAnchor = 0;
+    cycleBase = cycles;
+    ITMWrite32(static_cast<uint8_t>(Channel::CYCLE_COUNT), cycles);
+    return true;
+}
+
+void NO_INSTRUMENT WriteCycleDelta(uint32_t delta) {
+    /* The varint goes out in a single write, a three byte one padded with a zero byte */
+    std::array<std::byte, sizeof(uint32_t)> varint{};
+    const size_t size = WriteVarint(varint.data(), delta);
+    uint32_t value;
+    std::memcpy(&value, varint.data(), sizeof(value));
+    WritePort(Channel::CYCLE_DELTA, value, size == 3 ? 4 : size);
+}
+}
+
+void NO_INSTRUMENT SendCycleCount() {
+    const IrqLockGuard lock{};
+    const uint32_t cycles = DWT->CYCCNT;
+    if (SendCycleAnchorIfDue(cycles)) {
+        return;
+    }
+    WriteCycleDelta(cycles - cycleBase);
+    cycleBase = cycles;
+}
+
+void NO_INSTRUMENT SendFunctionEvent(uint32_t function, bool exit) {
+    const IrqLockGuard lock{};
+    const uint32_t cycles = DWT->CYCCNT;
+    const uint32_t cycleDelta = cycles - cycleBase;
+    const uint32_t addressDelta = function - functionBase;
+
+    /* Right after an anchor the full address is sent as well, so the host can start decoding there */
+    const bool anchored = SendCycleAnchorIfDue(cycles);
+    cycleBase = cycles;
+    functionBase = function;
+
+    if (!anchored && ++functionsSinceAddress < RECORD_ANCHOR_INTERVAL) {
+        uint32_t word;
+        if (EncodeFunctionEvent(FUNCTION_EVENT_SHORT, exit, addressDelta, cycleDelta, word)) {
+            WritePort(Channel::FUNCTION_EVENT, word, 2);
+            SendSequenceIfDue();
+            return;
+        }
+        if (EncodeFunctionEvent(FUNCTION_EVENT_LONG, exit, addressDelta, cycleDelta, word)) {
+            WritePort(Channel::FUNCTION_EVENT, word, 4);
+            SendSequenceIfDue();
+            return;
+        }
+    }
+
+    if (!anchored) {
+        WriteCycleDelta(cycleDelta);
+    }
+    functionsSinceAddress = 0;
+    WritePort(exit ? Channel::FUNCTION_EXIT : Channel::FUNCTION_ENTER, function, 4);
+    SendSequenceIfDue();
+}
+
+void NO_INSTRUMENT SendRecord(uint8_t messageTypeIndex, uint32_t cycles, std::span<const std::byte> payload) {
+    const IrqLockGuard lock{};
+    SendCycleAnchorIfDue(cycles);
+
+    static std::array<std::byte, RECORD_MAX_HEADER_SIZE + spor_BUFFER_SIZE> record;
+    size_t size = 0;
+    record[size++] = static_cast<std::byte>(messageTypeIndex);
+    size += WriteVarint(&record[size], cycles - cycleBase);
+    size += WriteVarint(&record[size], static_cast<uint32_t>(payload.size()));
+    std::memcpy(&record[size], payload.data(), payload.size());
+    size += payload.size();
+    cycleBase = cycles;
+
+    SendChannel(Channel::RECORD, {record.data(), size});
+    SendSequenceIfDue();
+}
+#endif
+
 }
@@ -6,18 +6,28 @@
 #include <span>
 
 #include SPOR_SYSTEM_HEADER
+#include "DeferredTransport.hpp"
 #include "IrqLockGuard.hpp"
 #include "orbcode/trace/itm.h"
+#include "spor-common/EventCategory.hpp"
 #include "spor-common/Messages.hpp"
+#include "spor-common/Record.hpp"
 #include "Utils.hpp"
 #include "zpp_bits.h"
 
+/* Categories of events that are sent, see EventCategory. Kept in RAM so a debugger can change it while running. */
+extern "C" volatile uint32_t spor_event_mask;
+
 namespace spor {
 
 #ifndef spor_BUFFER_SIZE
 #define spor_BUFFER_SIZE 100
 #endif
 
+#ifndef spor_EVENT_MASK
+#define spor_EVENT_MASK EVENT_CATEGORY_ALL
+#endif
+
 template <typename T, typename Variant>
 struct VariantIndex;
 
@@ -42,32 +52,155 @@ public:
 
 void NO_INSTRUMENT SendChannel(Channel channel, std::span<const std::byte> data);
 
+/**
+ * Counts a message or function event and sends the count on Channel::SEQUENCE when SEQUENCE_INTERVAL are due.
+ * Call it with interrupts locked, after the last packet of the message.
+ */
+void NO_INSTRUMENT SendSequenceIfDue();
+
+/** Sends a zone begin or end as the timestamp and one write on Channel::ZONE */
+void NO_INSTRUMENT SendZoneEvent(uint32_t name, bool end);
+
+inline NO_INSTRUMENT bool IsEventEnabled(EventCategory category) {
+    return (spor_event_mask & static_cast<uint32_t>(category)) != 0;
+}
+
+#ifdef SPOR_COMPACT_RECORDS
+/** Sends a message as one record on Channel::RECORD, see spor-common/Record.hpp */
+void NO_INSTRUMENT SendRecord(uint8_t messageTypeIndex, uint32_t cycles, std::span<const std::byte> payload);
+
+/** Sends the cycle count as a varint delta on CYCLE_DELTA, or as an absolute CYCLE_COUNT when one is due */
+void NO_INSTRUMENT SendCycleCount();
+
+/** Sends a function entry or exit together with its timestamp, see FUNCTION_EVENT in spor-common/Record.hpp */
+void NO_INSTRUMENT SendFunctionEvent(uint32_t function, bool exit);
+#else
 /** Todo: Merge with below */
 inline NO_INSTRUMENT void SendCycleCount() {
-    // const IrqLockGuard lock{};
     ITMWrite32(static_cast<uint8_t>(Channel::CYCLE_COUNT), DWT->CYCCNT);
 }
+#endif
 
-template <typename T>
-void NO_INSTRUMENT Send(const T &message) {
-    if (!Transport::isReady())
+/**
+ * Sends the message type and payload length as a single ITM write on MESSAGE_TYPE: a 16-bit write of
+ * [type, length] when the length fits in a byte, otherwise a 32-bit write of [type, length (16 bits), 0].
+ * The host then knows exactly how many MESSAGE_DATA bytes belong to the message.
+ */
+inline NO_INSTRUMENT void SendMessageHeader(uint8_t messageTypeIndex, size_t length) {
+    constexpr uint8_t port = static_cast<uint8_t>(Channel::MESSAGE_TYPE);
+    if (!ITMIsPortEnabled(port))
         return;
 
-    const IrqLockGuard lock{};
+    while (ITM->PORT[port].u32 == 0UL) {
+        __NOP();
+    }
+    if constexpr (spor_BUFFER_SIZE <= UINT8_MAX) {
+        ITM->PORT[port].u16 = static_cast<uint16_t>(messageTypeIndex | (length << 8));
+    } else {
+        ITM->PORT[port].u32 = static_cast<uint32_t>(messageTypeIndex | (length << 8));
+    }
+}
 
-    SendCycleCount();
+/** Stands in for a zpp_bits archive to reach the strings of a message through its serialize() */
+struct StringInterner {
+    bool forget = false;
+    bool defined = false;
+
+    std::errc operator()(auto &...members) {
+        (Visit(members), ...);
+        return {};
+    }
+
+    void Visit(StringOrSymbol &string) {
+        if (forget) {
+            string.ForgetInterned();
+        } else {
+            defined |= string.Intern();
+        }
+    }
+
+    void Visit(const auto &) {}
+};
+
+template <typename T>
+concept HasStrings = requires(StringInterner &interner, T &message) { T::serialize(interner, message); };
 
-    constexpr uint8_t messageTypeIndex = GetMessageIndex<T>();
-    SendChannel(Channel::MESSAGE_TYPE, std::span{reinterpret_cast<const std::byte *>(&messageTypeIndex), 1});
+/** Interns the RAM strings of `message`. Returns whether any string table id was defined. */
+template <typename T>
+NO_INSTRUMENT bool InternStrings(T &message) {
+    if constexpr (HasStrings<T>) {
+        StringInterner interner;
+        T::serialize(interner, message);
+        return interner.defined;
+    }
+    return false;
+}
+
+/** Undoes InternStrings for a message that was dropped, so that its definitions are sent with the next use */
+template <typename T>
+NO_INSTRUMENT void ForgetStrings(T &message) {
+    if constexpr (HasStrings<T>) {
+        StringInterner interner{.forget = true};
+        T::serialize(interner, message);
+    }
+}
+
+#ifdef SPOR_DEFERRED_TRANSPORT
+/** Serializes `message` into the ring of the current context. Returns false when it did not fit. */
+template <typename T>
+NO_INSTRUMENT bool QueueMessage(const T &message) {
+    /* The buffer is on the stack since a more urgent context can call Send while this one is serializing */
+    const uint32_t cycles = DWT->CYCCNT;
+    std::array<std::byte, spor_BUFFER_SIZE> buffer;
+    auto out = zpp::bits::out{buffer};
+    if (zpp::bits::failure(out(message))) {
+        return false;
+    }
+    return DeferredWrite(GetMessageIndex<T>(), cycles, std::span<const std::byte>{buffer.data(), out.position()});
+}
+#endif
+
+template <typename T>
+void NO_INSTRUMENT Send(T message) {
+    static_assert(spor_BUFFER_SIZE <= UINT16_MAX, "Message length must fit in the 16-bit length field");
+
+    if (!IsEventEnabled(GetEventCategory<T>()) || !Transport::isReady())
+        return;
+
+#ifdef SPOR_DEFERRED_TRANSPORT
+    /* Only queued here and written to the ITM by DeferredDrain. Messages without strings are queued with interrupts
+     * enabled. Interning takes the lock until the message is queued: the drain sends the rings in cycle count order,
+     * so a use of a string id that is queued later also goes out after its definition. */
+    if constexpr (HasStrings<T>) {
+        const IrqLockGuard lock{};
+        InternStrings(message);
+        if (!QueueMessage(message)) {
+            ForgetStrings(message);
+        }
+    } else {
+        QueueMessage(message);
+    }
+#else
+    const IrqLockGuard lock{};
 
+    InternStrings(message);
     static std::array<std::byte, spor_BUFFER_SIZE> buffer;
     auto out = zpp::bits::out{buffer};
     auto result = out(message);
     if (zpp::bits::failure(result)) {
+        ForgetStrings(message);
         return;
     }
-    auto data = std::span<const std::byte>{buffer.data(), out.position()};
-    SendChannel(Channel::MESSAGE_DATA, data);
+
+#ifdef SPOR_COMPACT_RECORDS
+    SendRecord(GetMessageIndex<T>(), DWT->CYCCNT, std::span<const std::byte>{buffer.data(), out.position()});
+#else
+    SendCycleCount();
+    SendMessageHeader(GetMessageIndex<T>(), out.position());
+    SendChannel(Channel::MESSAGE_DATA, std::span<const std::byte>{buffer.data(), out.position()});
+    SendSequenceIfDue();
+#endif
+#endif
 }
 
 }
\ No newline at end of file
@@ -327,6 +327,42 @@ const profiler::SymbolInfo *ElfSymbolResolver::GetSymbolInfo(uint32_t address) {
     return nullptr;
 }
 
+const profiler::SymbolInfo *ElfSymbolResolver::GetFunctionContaining(TargetPointer address) {
+    if (functionRanges.empty()) {
+        BuildFunctionRanges();
+    }
+
+    auto it = std::upper_bound(
+        functionRanges.begin(), functionRanges.end(), address,
+        [](uint32_t value, const FunctionRange &range) { return value < range.start; }
+    );
+    if (it == functionRanges.begin()) {
+        return nullptr;
+    }
+    --it;
+    return address < it->end ? it->symbol : nullptr;
+}
+
+void ElfSymbolResolver::BuildFunctionRanges() {
+    for (const auto &[address, symbol] : symbols) {
+        if (symbol.type == profiler::SymbolType::Function) {
+            /* Thumb function symbols have bit 0 set, code addresses do not */
+            const uint32_t start = address & ~1u;
+            functionRanges.push_back({start, start + symbol.size, &symbol});
+        }
+    }
+    std::sort(functionRanges.begin(), functionRanges.end(), [](const FunctionRange &a, const FunctionRange &b) {
+        return a.start < b.start;
+    });
+
+    /* Symbols without a size (e.g. from assembly) extend up to the next function */
+    for (size_t i = 0; i + 1 < functionRanges.size(); ++i) {
+        if (functionRanges[i].end == functionRanges[i].start) {
+            functionRanges[i].end = functionRanges[i + 1].start;
+        }
+    }
+}
+
 bool ElfSymbolResolver::IsValid() const {
     return isInitialized && elfFd >= 0;
 }
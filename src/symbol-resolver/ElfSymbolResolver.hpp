@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <gelf.h>
 
 #include "spor-common/TargetPointer.hpp"
@@ -34,10 +35,21 @@ public:
 
     const profiler::SymbolInfo *GetSymbolInfo(TargetPointer address) override;
     bool IsValid() const override;
+    const profiler::SymbolInfo *GetFunctionContaining(TargetPointer address) override;
 
 private:
     static ElfSymbolResolver *instance;
 
+    struct FunctionRange {
+        uint32_t start;
+        uint32_t end;
+        const profiler::SymbolInfo *symbol;
+    };
+    /* Function symbols sorted by address, built on the first GetFunctionContaining call */
+    std::vector<FunctionRange> functionRanges;
+
+    void BuildFunctionRanges();
+
     bool LoadSymbols();
     bool LoadDwarfSymbols();
     bool LoadElfSymbols();
@@ -32,6 +32,11 @@ public:
 
     virtual const SymbolInfo *GetSymbolInfo(uint32_t address) = 0;
     virtual bool IsValid() const = 0;
+
+    /** The function whose code contains `address`, e.g. for a sampled PC. Only exact matches by default. */
+    virtual const SymbolInfo *GetFunctionContaining(uint32_t address) {
+        return GetSymbolInfo(address);
+    }
 };
 
 void SetSymbolResolver(std::unique_ptr<SymbolResolver> resolver);